@@ -11,6 +11,9 @@
 #include "version_buffer.h"
 #include "addr_trans_table.h"
 #include "migration_controller.h"
+#include "stream_detector.h"
+#include "trans_cache.h"
+#include "crash_recovery.h"
 #include "profiler.h"
 
 #ifdef MEMCK
@@ -27,11 +30,17 @@ enum Control {
   WAIT_CKPT,
 };
 
-class AddrTransController {
+/// The store type is a template parameter so that its callbacks can be
+/// inlined when the concrete type is known, e.g., in host benchmarks.
+/// AddrTransController keeps the virtual MemStore interface for gem5.
+template <class Store>
+class BasicAddrTransController {
  public:
-  AddrTransController(uint64_t dram_size, Addr phy_limit,
-      int att_len, int block_bits, int page_bits, MemStore* ms);
-  virtual ~AddrTransController() { }
+  /// @depth Number of NVM backup versions, i.e., at most depth - 1 epochs
+  /// can be in checkpointing at the same time.
+  BasicAddrTransController(uint64_t phy_range, uint64_t dram_size,
+      int att_len, int block_bits, int page_bits, Store* ms, int depth = 2);
+  virtual ~BasicAddrTransController() { }
 
   virtual Addr LoadAddr(Addr phy_addr, Profiler& pf);
   virtual Control Probe(Addr phy_addr);
@@ -47,7 +56,23 @@ class AddrTransController {
   int block_size() const { return att_.block_size(); }
   int page_size() const { return migrator_.page_size(); }
   int att_length() const { return att_.length(); }
-  bool in_checkpointing() const { return in_checkpointing_; }
+  int att_dirty_length() const { return att_.GetLength(ATTEntry::DIRTY); }
+  /// ATT entries that versions new to the epoch can take before it ends,
+  /// as Probe() sees them
+  virtual int att_free_length() const {
+    return in_checkpointing() ? att_.GetLength(ATTEntry::FREE) +
+        att_.GetLength(ATTEntry::CLEAN) : att_.length() - att_dirty_length();
+  }
+  bool in_checkpointing() const { return ckpt_epochs_; }
+  /// Number of epochs whose checkpoints are not finished
+  int ckpt_epochs() const { return ckpt_epochs_; }
+  /// If a backup level is left for another epoch to begin checkpointing,
+  /// and no dirty DRAM page would write back over the copy that the last
+  /// finished checkpoint keeps, e.g., the home of a page moved in as static
+  bool ckpt_available() const {
+    return ckpt_epochs_ < nvm_buffer_.depth() - 1 &&
+        !migrator_.num_rewritten_entries();
+  }
 
   const VersionBuffer& nvm_buffer() const { return nvm_buffer_; }
   const VersionBuffer& dram_buffer() const { return dram_buffer_; }
@@ -55,8 +80,55 @@ class AddrTransController {
 
   uint64_t pages_to_dram() const { return pages_to_dram_; }
   uint64_t pages_to_nvm() const { return pages_to_nvm_; }
+  /// Number of NVM pages promoted to or predicted in DRAM on write streams
+  uint64_t pages_streamed() const { return pages_streamed_; }
+
+  /// Promotes a NVM page at the end of the epoch in which it sees @blocks
+  /// sequential or strided block writes, ahead of the pages ranked by
+  /// dirty ratio, and moves the next page of the stream to DRAM at once,
+  /// so that the stream stops filling the ATT (0 to disable)
+  void set_stream_blocks(int blocks) { stream_blocks_ = blocks; }
+  int stream_blocks() const { return stream_blocks_; }
+
+  /// Caches ATT and PTT entries in front of the tables kept in DRAM,
+  /// so that misses fetch the entries (zero entries to keep a table in SRAM)
+  void set_trans_caches(int att_entries, int ptt_entries, int assoc);
+  const TransCache& att_cache() const { return att_cache_; }
+  const TransCache& ptt_cache() const { return ptt_cache_; }
+  /// Bytes of the ATT followed by the PTT in memory
+  uint64_t meta_size() const;
+  /// Adds the ATT and PTT blocks modified since the last checkpoint to
+  /// the list, offset by the address of the tables in memory
+  virtual int AddMetaBlocks(Addr meta_base, std::vector<Addr>* list);
+  virtual int meta_dirty_blocks() const {
+    return att_.meta().num_dirty() + migrator_.meta().num_dirty();
+  }
+
+  /// Keeps a snapshot of the metadata that each checkpoint persists,
+  /// for power failure simulation
+  void set_meta_snapshot(bool enable) { snapshot_meta_ = enable; }
+  /// Metadata persisted by the latest checkpoint begun
+  const MetaSnapshot& ckpt_meta() const { return ckpt_meta_; }
 
   virtual bool IsDRAM(Addr phy_addr, Profiler& pf);
+  /// Hint of whether a write of the block needs no new ATT entry,
+  /// i.e., it hits a dirty version of the running epoch or a DRAM page
+  bool AbsorbsWrite(Addr phy_addr);
+  /// Translates an address for accesses out of the controller's notice,
+  /// e.g., functional writes. A zero version then gets its own slot,
+  /// so that such writes never reach the shared zero block.
+  Addr UntrackedAddr(Addr phy_addr);
+  /// Makes an untracked write to @mach_addr durable at once. For a page
+  /// cached in DRAM, the write is copied to both NVM copies of the page.
+  void UntrackedStore(Addr phy_addr, Addr mach_addr, int size);
+
+  /// Shared all-zero block that zero versions map to without a slot
+  Addr zero_base() const { return zero_base_; }
+  /// NVM region of the static copies of pages cached in DRAM
+  Addr backup_base() const { return backup_base_; }
+  /// DRAM region of the cached pages
+  Addr cache_base() const { return cache_base_; }
+  uint64_t zero_blocks() const { return zero_blocks_; }
 #ifdef MEMCK
   std::pair<AddrInfo, AddrInfo> GetAddrInfo(Addr phy_addr);
 #endif
@@ -67,9 +139,19 @@ class AddrTransController {
   VersionBuffer dram_buffer_;
   MigrationController migrator_;
 
- private:
   bool CheckValid(Addr phy_addr, int size);
   bool FullBlock(Addr phy_addr, int size);
+  void CopyBlockIntra(Addr dest_addr, Addr src_addr,
+      Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL);
+  void CopyBlockInter(Addr dest_addr, Addr src_addr,
+      Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL);
+
+  Store* mem_store_;
+  int ckpt_epochs_;
+  Profiler null_pf_; ///< Sink of operations that are not modeled
+  Profiler overlap_pf_; ///< Sink of operations overlapped with others
+
+ private:
 
   int Setup(Addr phy_addr, Addr mach_base, ATTEntry::State state,
       bool move_data, Profiler& pf);
@@ -86,85 +168,186 @@ class AddrTransController {
   Addr NVMStore(Addr phy_addr, int size, Profiler& pf);
   Addr DRAMStore(Addr phy_addr, int size, const PTTEntry& page, Profiler& pf);
 
+  /// Charge the translation cache lookups of an access
+  void CacheATT(Addr phy_addr, Profiler& pf);
+  void CachePTT(Addr phy_addr, Profiler& pf);
+
   void Discard(int index, VersionBuffer& vb, Profiler& pf);
+  /// Turns a dirty version of all zeros into a CLEAN one on the zero block
+  bool ElideZero(int index, VersionBuffer& vb);
+  bool IsZeroVersion(const ATTEntry& entry) const {
+    return entry.mach_base == zero_base_;
+  }
   /// Move a DRAM page out
   void MigrateDRAM(const DRAMPageStats& stats,
       std::vector<Addr>& ckpt_blocks, Profiler& pf);
   /// Move a NVM page out
   void MigrateNVM(const NVMPageStats& stats,
       std::vector<Addr>& ckpt_blocks, Profiler& pf);
+  /// Move the NVM pages written in streams out. Only done at the end of
+  /// an epoch, whose checkpoint persists the versions moved along with
+  /// the PTT entry.
+  void PromoteStreams(std::vector<Addr>& ckpt_blocks, Profiler& pf);
+  /// Move the NVM page a write stream heads to in before its first write.
+  /// Only done if the page has no versions, so that it is set up clean
+  /// and direct in the middle of an epoch.
+  void PredictStream(Addr page_addr, Profiler& pf);
+  /// Writes the blocks of dirty DRAM pages back to their alternate copies
+  void WriteBackPages(std::vector<Addr>& ckpt_blocks, Profiler& pf);
+  /// Takes the metadata as persisted by a checkpoint at its beginning
+  void SnapshotMeta();
+
+  Addr CacheBase(const PTTEntry& page) const {
+    return cache_base_ + ((Addr)page.index << migrator_.page_bits());
+  }
+  Addr BackupBase(const PTTEntry& page) const {
+    return backup_base_ + migrator_.BackupOffset(page);
+  }
+  /// Copies the blocks of a page marked in a dirty bitmap, adds them to
+  /// the checkpoint list, and returns their number
+  int CopyPageBlocks(Addr dest_base, Addr src_base, uint64_t blocks,
+      std::vector<Addr>& ckpt_blocks);
 
-  void CopyBlockIntra(Addr dest_addr, Addr src_addr,
-      Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL);
-  void CopyBlockInter(Addr dest_addr, Addr src_addr,
-      Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL);
   void SwapBlock(Addr direct_addr, Addr mach_addr,
       Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL);
 
   const uint64_t phy_range_; ///< Size of physical address space
-  MemStore* mem_store_;
-  bool in_checkpointing_;
+  Addr zero_base_;
+  Addr backup_base_;
+  Addr cache_base_;
+  StreamDetector streams_;
+  int stream_blocks_;
+  std::vector<Addr> stream_pages_; ///< Written in streams in the epoch
+  TransCache att_cache_;
+  TransCache ptt_cache_;
+  bool snapshot_meta_;
+  MetaSnapshot ckpt_meta_;
 
   uint64_t pages_to_dram_; ///< Sum number of pages migrated from NVM to DRAM
   uint64_t pages_to_nvm_; ///< Sum number of pages migrated from DRAM to NVM
+  uint64_t zero_blocks_; ///< Sum number of versions elided as zero blocks
+  uint64_t pages_streamed_;
 
-  class DirtyCleaner : public QueueVisitor { // inc. TEMP and HIDDEN
+  class DirtyCleaner { // inc. TEMP and HIDDEN
    public:
-    DirtyCleaner(AddrTransController* atc,
+    DirtyCleaner(BasicAddrTransController* atc,
         Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL) :
         atc_(atc), pf_(pf), ckpt_blocks_(ckpt_blocks) { }
     void Visit(int i);
    private:
-    AddrTransController* atc_;
+    BasicAddrTransController* atc_;
     Profiler& pf_;
     std::vector<Addr>* ckpt_blocks_;
   };
 
-  class LoanRevoker : public QueueVisitor {
+  class LoanRevoker {
    public:
-    LoanRevoker(AddrTransController* atc,
+    LoanRevoker(BasicAddrTransController* atc,
         Profiler& pf, std::vector<Addr>* ckpt_blocks = NULL) :
         atc_(atc), pf_(pf), ckpt_blocks_(ckpt_blocks) { }
     void Visit(int i);
    private:
-    AddrTransController* atc_;
+    BasicAddrTransController* atc_;
     Profiler& pf_;
     std::vector<Addr>* ckpt_blocks_;
   };
 };
 
-inline uint64_t AddrTransController::Size() const {
-  return phy_range_ + nvm_buffer_.Size() + dram_buffer_.Size();
+typedef BasicAddrTransController<MemStore> AddrTransController;
+
+template <class Store>
+inline uint64_t BasicAddrTransController<Store>::Size() const {
+  return cache_base_ + migrator_.dram_capacity();
+}
+
+template <class Store>
+inline uint64_t BasicAddrTransController<Store>::meta_size() const {
+  return att_.meta().size() + migrator_.meta().size();
+}
+
+template <class Store>
+inline int BasicAddrTransController<Store>::AddMetaBlocks(Addr meta_base,
+    std::vector<Addr>* list) {
+  int num = att_.FlushMeta(meta_base, list);
+  return num + migrator_.FlushMeta(meta_base + att_.meta().size(), list);
 }
 
-inline bool AddrTransController::IsDRAM(Addr phy_addr, Profiler& pf) {
+template <class Store>
+inline void BasicAddrTransController<Store>::set_trans_caches(
+    int att_entries, int ptt_entries, int assoc) {
+  att_cache_.Resize(att_entries, assoc);
+  ptt_cache_.Resize(ptt_entries, assoc);
+}
+
+template <class Store>
+inline void BasicAddrTransController<Store>::CacheATT(Addr phy_addr,
+    Profiler& pf) {
+  if (!att_cache_.enabled()) return;
+  const Tag tag = att_.ToTag(phy_addr);
+  const bool hit = att_cache_.Access(tag);
+  const int64_t lat = mem_store_->GetMetaLatency(
+      (tag % att_.length()) * MetaTracker::kEntrySize, hit);
+  if (lat > 0) pf.AddLatency(lat);
+}
+
+template <class Store>
+inline void BasicAddrTransController<Store>::CachePTT(Addr phy_addr,
+    Profiler& pf) {
+  if (!ptt_cache_.enabled()) return;
+  const Addr page = phy_addr >> migrator_.page_bits();
+  const bool hit = ptt_cache_.Access(page);
+  const int64_t lat = mem_store_->GetMetaLatency(att_.meta().size() +
+      (page % migrator_.ptt_capacity()) * MetaTracker::kEntrySize, hit);
+  if (lat > 0) pf.AddLatency(lat);
+}
+
+template <class Store>
+inline bool BasicAddrTransController<Store>::IsDRAM(Addr phy_addr,
+    Profiler& pf) {
   return migrator_.Contains(phy_addr, pf);
 }
 
-inline bool AddrTransController::CheckValid(Addr phy_addr, int size) {
+template <class Store>
+inline bool BasicAddrTransController<Store>::AbsorbsWrite(Addr phy_addr) {
+  const int index = att_.Find(att_.ToTag(phy_addr));
+  if (index != -EINVAL) {
+    return att_.At(index).state != ATTEntry::CLEAN;
+  }
+  // DRAM pages take LOAN entries in checkpointing.
+  return !in_checkpointing() && migrator_.Contains(phy_addr, null_pf_);
+}
+
+template <class Store>
+inline bool BasicAddrTransController<Store>::CheckValid(Addr phy_addr,
+    int size) {
   return att_.ToTag(phy_addr) == att_.ToTag(phy_addr + size - 1);
 }
 
-inline bool AddrTransController::FullBlock(Addr phy_addr, int size) {
+template <class Store>
+inline bool BasicAddrTransController<Store>::FullBlock(Addr phy_addr,
+    int size) {
   return (phy_addr & (att_.block_size() - 1)) == 0 && size == att_.block_size();
 }
 
-inline void AddrTransController::CopyBlockIntra(Addr dest, Addr src,
-    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+template <class Store>
+inline void BasicAddrTransController<Store>::CopyBlockIntra(
+    Addr dest, Addr src, Profiler& pf, std::vector<Addr>* ckpt_blocks) {
   mem_store_->MemCopy(dest, src, att_.block_size());
   pf.AddBlockMoveIntra();
   if (ckpt_blocks) ckpt_blocks->push_back(dest);
 }
 
-inline void AddrTransController::CopyBlockInter(Addr dest, Addr src,
-    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+template <class Store>
+inline void BasicAddrTransController<Store>::CopyBlockInter(
+    Addr dest, Addr src, Profiler& pf, std::vector<Addr>* ckpt_blocks) {
   mem_store_->MemCopy(dest, src, att_.block_size());
   pf.AddBlockMoveInter();
   if (ckpt_blocks) ckpt_blocks->push_back(dest);
 }
 
-inline void AddrTransController::SwapBlock(Addr direct_addr, Addr mach_addr,
-    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+template <class Store>
+inline void BasicAddrTransController<Store>::SwapBlock(
+    Addr direct_addr, Addr mach_addr, Profiler& pf, std::vector<Addr>* ckpt_blocks) {
   mem_store_->MemSwap(direct_addr, mach_addr, att_.block_size());
   pf.AddBlockMoveIntra(3);
   if (ckpt_blocks) {
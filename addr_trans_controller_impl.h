@@ -0,0 +1,778 @@
+// addr_trans_controller_impl.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_ADDR_TRANS_CONTROLLER_IMPL_H_
+#define SEXAIN_ADDR_TRANS_CONTROLLER_IMPL_H_
+
+#include <vector>
+#include "addr_trans_controller.h"
+#include "base/trace.hh"
+#include "debug/Migration.hh"
+
+// Space partition (low -> high):
+// phy_limit || NVM buffer || zero block || DRAM buffer ||
+// NVM backup (page aligned) || DRAM cache
+template <class Store>
+BasicAddrTransController<Store>::BasicAddrTransController(
+    uint64_t phy_range, uint64_t dram_size,
+    int att_len, int block_bits, int page_bits, Store* ms, int depth):
+
+    att_(att_len, block_bits),
+    nvm_buffer_(depth * att_len, block_bits, depth),
+    dram_buffer_(att_len, block_bits),
+    migrator_(block_bits, page_bits, dram_size >> page_bits),
+    null_pf_(block_bits, page_bits), overlap_pf_(block_bits, page_bits),
+    phy_range_(phy_range), streams_(block_bits, page_bits), stream_blocks_(0),
+    snapshot_meta_(false),
+    pages_to_dram_(0), pages_to_nvm_(0), zero_blocks_(0), pages_streamed_(0) {
+
+  assert(phy_range >= dram_size);
+  mem_store_ = ms;
+  ckpt_epochs_ = 0;
+
+  nvm_buffer_.set_addr_base(phy_range_);
+  zero_base_ = nvm_buffer_.addr_base() + nvm_buffer_.Size();
+  dram_buffer_.set_addr_base(zero_base_ + block_size());
+  backup_base_ = migrator_.PageAlign(dram_buffer_.addr_base() +
+      dram_buffer_.Size() + page_size() - 1);
+  cache_base_ = backup_base_ + migrator_.backup_size();
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::LoadAddr(Addr phy_addr, Profiler& pf) {
+  CacheATT(phy_addr, pf);
+  int index = att_.Lookup(att_.ToTag(phy_addr), pf);
+  if (index != -EINVAL) {
+    const ATTEntry& entry = att_.At(index);
+    att_.AddBlockRead(index);
+    Addr mach_addr = att_.Translate(phy_addr, entry.mach_base);
+    bool is_dram = (entry.state == ATTEntry::TEMP ||
+        entry.state == ATTEntry::LOAN ||
+        entry.state == ATTEntry::STAINED);
+    pf.set_path(entry.state == ATTEntry::LOAN ?
+        Profiler::DRAM_CACHE : Profiler::NVM_ATT);
+    pf.AddLatency(mem_store_->GetReadLatency(mach_addr, is_dram, NULL));
+    return mach_addr;
+  } else {
+    CachePTT(phy_addr, pf);
+    PTTEntry page = migrator_.LookupPage(phy_addr, pf);
+    Addr mach_addr;
+    if (page.index < 0) {
+      mach_addr = phy_addr;
+      pf.set_path(Profiler::NVM_DIRECT);
+      pf.AddLatency(mem_store_->GetReadLatency(mach_addr, false, NULL));
+    } else {
+      migrator_.AddDRAMPageRead(page.mach_base);
+      pf.set_path(Profiler::DRAM_CACHE);
+      mach_addr = migrator_.Translate(phy_addr, CacheBase(page));
+      pf.AddLatency(mem_store_->GetReadLatency(mach_addr, true, &page));
+    }
+    return mach_addr;
+  }
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::DRAMStore(Addr phy_addr, int size,
+    const PTTEntry& page, Profiler& pf) {
+  const Addr cache_addr = migrator_.Translate(phy_addr, CacheBase(page));
+  int index = att_.Lookup(att_.ToTag(phy_addr), pf);
+  if (index != -EINVAL) { // found
+    const ATTEntry& entry = att_.At(index);
+    mem_store_->OnATTWriteHit(entry.state);
+    pf.set_path(Profiler::DRAM_CACHE);
+    if (in_checkpointing()) {
+      Addr mach_addr = att_.Translate(phy_addr, entry.mach_base);
+      pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, true, NULL));
+      return mach_addr;
+    } else {
+      FreeLoan(index, !FullBlock(phy_addr, size), pf);
+      pf.AddLatency(mem_store_->GetWriteLatency(cache_addr, true, &page));
+      return cache_addr;
+    }
+  } else { // not found
+    if (in_checkpointing()) {
+      if (att_.IsEmpty(ATTEntry::FREE)) {
+        assert(!att_.IsEmpty(ATTEntry::CLEAN));
+        FreeClean(att_.GetFront(ATTEntry::CLEAN), pf);
+        mem_store_->OnATTWriteMiss(ATTEntry::LOAN);
+        pf.set_path(Profiler::ATT_EVICT);
+      } else {
+        mem_store_->OnATTWriteHit(ATTEntry::LOAN);
+        pf.set_path(Profiler::DRAM_LOAN);
+      }
+      const Addr mach_base = dram_buffer_.SlotAlloc(overlap_pf_);
+      if (!FullBlock(phy_addr, size)) {
+        CopyBlockIntra(mach_base, migrator_.BlockAlign(cache_addr), pf);
+      }
+      Setup(phy_addr, mach_base, ATTEntry::LOAN, false, pf);
+      Addr mach_addr = att_.Translate(phy_addr, mach_base);
+      pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, true, NULL));
+      return mach_addr;
+    } else { // in running
+      mem_store_->ckDRAMWriteHit();
+      pf.set_path(Profiler::DRAM_CACHE);
+      pf.AddLatency(mem_store_->GetWriteLatency(cache_addr, true, &page));
+      return cache_addr;
+    }
+  }
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::NVMStore(Addr phy_addr, int size,
+    Profiler& pf) {
+  const Tag phy_tag = att_.ToTag(phy_addr);
+  int index = att_.Lookup(phy_tag, pf);
+  Addr mach_addr;
+  if (!in_checkpointing()) {
+    if (index != -EINVAL) { // found
+      const ATTEntry& entry = att_.At(index);
+      mem_store_->OnATTWriteHit(entry.state);
+      pf.set_path(Profiler::NVM_ATT);
+      switch(entry.state) {
+      case ATTEntry::TEMP:
+        HideTemp(index, !FullBlock(phy_addr, size), pf);
+      case ATTEntry::DIRTY:
+      case ATTEntry::HIDDEN:
+        mach_addr = att_.Translate(phy_addr, entry.mach_base);
+        break;
+      case ATTEntry::STAINED:
+        mach_addr = att_.Translate(phy_addr,
+            DirtyStained(index, !FullBlock(phy_addr, size), pf));
+        break;
+      default:
+        HideClean(index, !FullBlock(phy_addr, size), pf);
+        mach_addr = phy_addr;
+        break;
+      }
+    } else { // not found
+      if (att_.IsEmpty(ATTEntry::FREE)) {
+        if (!att_.IsEmpty(ATTEntry::LOAN)) {
+          int li = att_.GetFront(ATTEntry::LOAN);
+          FreeLoan(li, true, pf);
+        } else {
+          assert(!att_.IsEmpty(ATTEntry::CLEAN));
+          int ci = att_.GetFront(ATTEntry::CLEAN);
+          FreeClean(ci, pf);
+        }
+        mem_store_->OnATTWriteMiss(ATTEntry::DIRTY);
+        pf.set_path(Profiler::ATT_EVICT);
+      } else {
+        mem_store_->OnATTWriteHit(ATTEntry::DIRTY);
+        pf.set_path(Profiler::NVM_ATT);
+      }
+      Addr mach_base = nvm_buffer_.SlotAlloc(overlap_pf_);
+      index = Setup(phy_addr, mach_base, ATTEntry::DIRTY,
+          !FullBlock(phy_addr, size), pf);
+      mach_addr = att_.Translate(phy_addr, mach_base);
+    }
+    pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, false, NULL));
+    att_.AddBlockWrite(index);
+    return mach_addr;
+  } else { // in checkpointing
+    if (index != -EINVAL) { // found
+      const ATTEntry& entry = att_.At(index);
+      mem_store_->OnATTWriteHit(entry.state);
+      pf.set_path(Profiler::NVM_ATT);
+      if (entry.state == ATTEntry::TEMP || entry.state == ATTEntry::STAINED) {
+        mach_addr = att_.Translate(phy_addr, entry.mach_base);
+      } else {
+        Addr mach_base = ResetClean(index, !FullBlock(phy_addr, size), pf);
+        mach_addr = att_.Translate(phy_addr, mach_base);
+      }
+    } else { // not found
+      if (att_.IsEmpty(ATTEntry::FREE)) {
+        assert(!att_.IsEmpty(ATTEntry::CLEAN));
+        FreeClean(att_.GetFront(ATTEntry::CLEAN), pf);
+        mem_store_->OnATTWriteMiss(ATTEntry::STAINED);
+        pf.set_path(Profiler::ATT_EVICT);
+      } else {
+        mem_store_->OnATTWriteHit(ATTEntry::STAINED);
+        pf.set_path(Profiler::NVM_ATT);
+      }
+      Addr mach_base = dram_buffer_.SlotAlloc(overlap_pf_);
+      index = Setup(phy_addr, mach_base, ATTEntry::STAINED,
+          !FullBlock(phy_addr, size), pf);
+      mach_addr = att_.Translate(phy_addr, mach_base);
+    }
+    pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, true, NULL));
+    att_.AddBlockWrite(index);
+    return mach_addr;
+  }
+}
+
+template <class Store>
+Control BasicAddrTransController<Store>::Probe(Addr phy_addr) {
+  // Out of ATT entries in checkpointing, another epoch begins if any
+  // backup level is left, otherwise the write stalls.
+  if (migrator_.Contains(phy_addr, null_pf_)) { // DRAM
+    if (in_checkpointing()) {
+      if (!att_.Contains(att_.ToTag(phy_addr), null_pf_) &&
+          att_.IsEmpty(ATTEntry::FREE) && att_.IsEmpty(ATTEntry::CLEAN)) {
+        return ckpt_available() ? NEW_EPOCH : WAIT_CKPT;
+      }
+    }
+  } else if (!att_.Contains(att_.ToTag(phy_addr), null_pf_)) { // NVM
+    if (in_checkpointing()) {
+      if (att_.IsEmpty(ATTEntry::FREE) && att_.IsEmpty(ATTEntry::CLEAN)) {
+        return ckpt_available() ? NEW_EPOCH : WAIT_CKPT;
+      }
+    } else if (att_.GetLength(ATTEntry::DIRTY) == att_.length() ||
+         migrator_.num_dirty_entries() >= migrator_.ptt_length() ) {
+      return NEW_EPOCH;
+    }
+  }
+  return REG_WRITE;
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::StoreAddr(Addr phy_addr, int size,
+    Profiler& pf) {
+  assert(CheckValid(phy_addr, size) && phy_addr < phy_range_);
+  CachePTT(phy_addr, pf);
+  CacheATT(phy_addr, pf);
+  PTTEntry page = migrator_.LookupPage(phy_addr, pf);
+  int stride;
+  if (stream_blocks_ && streams_.Write(phy_addr, stream_blocks_, &stride)) {
+    const Addr page_addr = migrator_.PageAlign(phy_addr);
+    if (page.index < 0) stream_pages_.push_back(page_addr);
+    if (stride > 0) {
+      PredictStream(page_addr + migrator_.page_size(), pf);
+    } else if (page_addr) {
+      PredictStream(page_addr - migrator_.page_size(), pf);
+    }
+  }
+  if (page.index < 0) {
+    mem_store_->statsNVMWrites();
+    Addr mach_addr = NVMStore(phy_addr, size, pf);
+    return mach_addr;
+  } else {
+    migrator_.AddDRAMPageWrite(phy_addr);
+    if (page.state == PTTEntry::CLEAN_STATIC) {
+      migrator_.ShiftState(page.mach_base, PTTEntry::DIRTY_DIRECT, pf);
+      page.state = PTTEntry::DIRTY_DIRECT;
+    } else if (page.state == PTTEntry::CLEAN_DIRECT) {
+      migrator_.ShiftState(page.mach_base, PTTEntry::DIRTY_STATIC, pf);
+      page.state = PTTEntry::DIRTY_STATIC;
+    }
+    mem_store_->statsDRAMWrites();
+    Addr mach_addr = DRAMStore(phy_addr, size, page, pf);
+    return mach_addr;
+  }
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::DirtyCleaner::Visit(int i) {
+  const ATTEntry& entry = atc_->att_.At(i);
+  if (entry.state == ATTEntry::STAINED) {
+    if (!atc_->ElideZero(i, atc_->dram_buffer_)) {
+      atc_->DirtyStained(i, true, pf_, ckpt_blocks_);
+    }
+  } else if (entry.state == ATTEntry::TEMP) {
+    // Home blocks may still back up epochs in checkpointing.
+    if (!atc_->in_checkpointing()) {
+      atc_->HideTemp(i, true, pf_, ckpt_blocks_);
+    } else if (!atc_->ElideZero(i, atc_->dram_buffer_)) {
+      atc_->DirtyStained(i, true, pf_, ckpt_blocks_);
+    }
+  } else if (entry.state == ATTEntry::DIRTY) {
+    atc_->ElideZero(i, atc_->nvm_buffer_);
+  }
+
+  if (entry.state == ATTEntry::DIRTY) {
+    atc_->att_.ShiftState(i, ATTEntry::CLEAN, atc_->overlap_pf_);
+  } else if (entry.state == ATTEntry::HIDDEN) {
+    atc_->att_.ShiftState(i, ATTEntry::FREE, atc_->overlap_pf_);
+  }
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::LoanRevoker::Visit(int i) {
+  const ATTEntry& entry = atc_->att_.At(i);
+  assert(entry.state == ATTEntry::LOAN);
+  atc_->FreeLoan(i, true, pf_, ckpt_blocks_);
+}
+
+template <class Store>
+int BasicAddrTransController<Store>::CopyPageBlocks(Addr dest_base,
+    Addr src_base, uint64_t blocks, std::vector<Addr>& ckpt_blocks) {
+  const std::vector<Addr>::size_type begin = ckpt_blocks.size();
+  const int num = migrator_.AddToBlockList(dest_base, blocks, &ckpt_blocks);
+  for (std::vector<Addr>::size_type i = begin; i < ckpt_blocks.size(); ++i) {
+    const Addr dest = ckpt_blocks[i];
+    mem_store_->MemCopy(dest, src_base + (dest - dest_base), block_size());
+  }
+  return num;
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::MigrateDRAM(const DRAMPageStats& stats,
+    std::vector<Addr>& ckpt_blocks, Profiler& pf) {
+  DPRINTF(Migration, "Migrate DRAM page WR=%f, from %s.\n",
+      stats.write_ratio, PTTEntry::state_strings[stats.state]);
+  // Only blocks missed by the home are moved. The last checkpoint keeps
+  // the page in the backup region unless it is direct.
+  const PTTEntry page = migrator_.LookupPage(stats.phy_addr, null_pf_);
+  const uint64_t dirty = page.dirty_blocks | page.stale_blocks;
+  if (stats.state == PTTEntry::CLEAN_STATIC) {
+    pf.AddBlockMoveIntra(CopyPageBlocks(stats.phy_addr, BackupBase(page),
+        page.stale_blocks, ckpt_blocks));
+  } else if (stats.state == PTTEntry::DIRTY_DIRECT) {
+    pf.AddBlockMoveInter(CopyPageBlocks(stats.phy_addr, CacheBase(page),
+        dirty, ckpt_blocks)); // for write back
+  } else {
+    // A dirty static page would overwrite the home of the last checkpoint.
+    assert(stats.state == PTTEntry::CLEAN_DIRECT);
+  }
+#ifdef MEMCK
+  Tag tag = att_.ToTag(stats.phy_addr);
+  for (int i = 0; i < migrator_.page_blocks(); ++i) {
+    assert(!att_.Contains(tag + i, null_pf_));
+  }
+#endif
+  migrator_.Free(stats.phy_addr, pf);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::MigrateNVM(const NVMPageStats& stats,
+    std::vector<Addr>& ckpt_blocks, Profiler& pf) {
+  Tag phy_tag = att_.ToTag(stats.phy_addr);
+  Tag next_page = att_.ToTag(stats.phy_addr + migrator_.page_size());
+  assert(next_page - phy_tag == migrator_.page_blocks());
+  // The DRAM copy takes the home and then the versions of the page,
+  // while the home is left to the last checkpoint.
+  migrator_.Setup(stats.phy_addr, PTTEntry::CLEAN_DIRECT, pf);
+  const PTTEntry page = migrator_.LookupPage(stats.phy_addr, null_pf_);
+  const Addr cache_base = CacheBase(page);
+  mem_store_->MemCopy(cache_base, stats.phy_addr, migrator_.page_size());
+  bool direct = true; // if the home is in sync
+
+  for (Tag tag = phy_tag; tag < next_page; ++tag) {
+    int index = att_.Lookup(tag, pf);
+    if (index == -EINVAL) {
+      pf.AddBlockMoveInter(); // for copying data to DRAM
+      continue;
+    }
+    const ATTEntry& entry = att_.At(index);
+    const Addr phy_addr = att_.ToAddr(entry.phy_tag);
+    const Addr cache_addr = migrator_.Translate(phy_addr, cache_base);
+
+    pf.set_ignore_latency();
+    switch (entry.state) {
+      case ATTEntry::CLEAN:
+        pf.AddBlockMoveInter(); // for copying data to DRAM
+        mem_store_->MemCopy(cache_addr, entry.mach_base, block_size());
+        // The slot is kept as the backup of the home.
+        FreeClean(index, pf);
+        ckpt_blocks.push_back(phy_addr);
+        break;
+      case ATTEntry::DIRTY:
+        pf.AddBlockMoveInter(); // for copying data to DRAM
+        mem_store_->MemCopy(cache_addr, entry.mach_base, block_size());
+        Discard(index, nvm_buffer_, pf);
+        direct = false;
+        break;
+      case ATTEntry::STAINED:
+      case ATTEntry::TEMP:
+        pf.AddBlockMoveIntra(); // for copying data to DRAM
+        mem_store_->MemCopy(cache_addr, entry.mach_base, block_size());
+        Discard(index, dram_buffer_, pf);
+        direct = false;
+        break;
+      case ATTEntry::LOAN:
+        assert(entry.state != ATTEntry::LOAN);
+      case ATTEntry::FREE:
+        assert(entry.state != ATTEntry::FREE);
+      case ATTEntry::HIDDEN:
+        pf.AddBlockMoveInter(); // for copying data to DRAM
+        att_.ShiftState(index, ATTEntry::FREE, pf);
+        break;
+    }
+    pf.clear_ignore_latency();
+  }
+  if (direct) {
+    DPRINTF(Migration, "Migrate NVM page to CLEAN_DIRECT.\n");
+  } else {
+    // The checkpoint writes the page to the backup region.
+    migrator_.ShiftState(stats.phy_addr, PTTEntry::CLEAN_STATIC, null_pf_);
+    const Addr backup_base = BackupBase(page);
+    mem_store_->MemCopy(backup_base, cache_base, migrator_.page_size());
+    migrator_.AddToBlockList(backup_base, &ckpt_blocks);
+    DPRINTF(Migration, "Migrate NVM page to CLEAN_STATIC.\n");
+  }
+  ++pages_to_dram_;
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::PromoteStreams(
+    std::vector<Addr>& ckpt_blocks, Profiler& pf) {
+  for (Addr page_addr : stream_pages_) {
+    // Leaves the spare PTT entries to exchanges.
+    if (migrator_.num_entries() >= migrator_.ptt_length()) break;
+    if (migrator_.Contains(page_addr, null_pf_)) continue;
+    const NVMPageStats stats = { page_addr, 1, 1 }; // written as a whole
+    MigrateNVM(stats, ckpt_blocks, pf);
+    DPRINTF(Migration, "Promote NVM page on a write stream.\n");
+    ++pages_streamed_;
+  }
+  stream_pages_.clear();
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::PredictStream(Addr page_addr,
+    Profiler& pf) {
+  // Leaves the spare PTT entries to exchanges.
+  if (page_addr >= phy_range_ ||
+      migrator_.num_entries() >= migrator_.ptt_length() ||
+      migrator_.Contains(page_addr, null_pf_)) return;
+  // Only a page without versions, whose home is the copy of every epoch
+  const Tag phy_tag = att_.ToTag(page_addr);
+  for (int i = 0; i < migrator_.page_blocks(); ++i) {
+    if (att_.Find(phy_tag + i) != -EINVAL) return;
+  }
+  migrator_.Setup(page_addr, PTTEntry::CLEAN_DIRECT, pf);
+  const PTTEntry page = migrator_.LookupPage(page_addr, null_pf_);
+  mem_store_->MemCopy(CacheBase(page), page_addr, migrator_.page_size());
+  pf.set_ignore_latency(); // ahead of the stream
+  pf.AddBlockMoveInter(migrator_.page_blocks()); // for copying data to DRAM
+  pf.clear_ignore_latency();
+  DPRINTF(Migration, "Predict NVM page on a write stream.\n");
+  ++pages_to_dram_;
+  ++pages_streamed_;
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::MigratePages(
+    std::vector<Addr>& ckpt_blocks, Profiler& pf, double dr, double wr) {
+  assert(ckpt_available());
+
+  LoanRevoker loan_revoker(this, pf, &ckpt_blocks);
+  att_.VisitQueue(ATTEntry::LOAN, &loan_revoker);
+  assert(att_.IsEmpty(ATTEntry::LOAN));
+
+  migrator_.InputBlocks(att_.entries());
+  // Pages are not moved under epochs in checkpointing.
+  if (in_checkpointing()) {
+    stream_pages_.clear();
+    return;
+  }
+  PromoteStreams(ckpt_blocks, pf);
+
+  NVMPageStats n;
+  DRAMPageStats d;
+  bool d_ready = false;
+  while (migrator_.ExtractNVMPage(n, pf)) {
+    if (migrator_.Contains(n.phy_addr, null_pf_)) continue; // streamed
+    DPRINTF(Migration, "Extract NVM page DR=%f/%f, PTT #=%d/%d\n",
+        n.dirty_ratio, dr, migrator_.num_entries(), migrator_.ptt_capacity());
+    if (n.dirty_ratio < dr) break;
+    // Find a DRAM page for exchange
+    if (migrator_.num_entries() == migrator_.ptt_capacity()) {
+      if (!migrator_.ExtractDRAMPage(d, overlap_pf_)) return;
+      DPRINTF(Migration, "\tExtract DRAM page WR=%f\n", d.write_ratio);
+      if (d.write_ratio > 0) {
+        d_ready = true;
+        break;
+      }
+      pf.set_ignore_latency();
+      MigrateDRAM(d, ckpt_blocks, pf);
+      pf.clear_ignore_latency();
+    }
+    MigrateNVM(n, ckpt_blocks, pf);
+  }
+  if ((!d_ready && !migrator_.ExtractDRAMPage(d, pf))) return;
+  int limit = migrator_.ptt_capacity() - migrator_.ptt_length();
+  do {
+    DPRINTF(Migration, "Extract DRAM page WR=%f, S=%d\n",
+        d.write_ratio, d.state);
+    if (d.write_ratio == 0) continue;
+    // Dirty static pages come last, and stay until their home is no
+    // longer the last checkpoint.
+    if (d.write_ratio > wr || d.state == PTTEntry::DIRTY_STATIC) break;
+    pf.set_ignore_latency();
+    MigrateDRAM(d, ckpt_blocks, pf);
+    pf.clear_ignore_latency();
+    ++pages_to_nvm_; // excluding clean DRAM pages exchanged with NVM pages
+    --limit;
+  } while (limit && migrator_.ExtractDRAMPage(d,
+      d.write_ratio == 0 ? null_pf_ : pf));
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::BeginCheckpointing(
+    std::vector<Addr>& ckpt_blocks, Profiler& pf) {
+  assert(ckpt_available());
+
+  // ATT flush
+  DirtyCleaner att_cleaner(this, pf, &ckpt_blocks);
+  att_.VisitQueue(ATTEntry::DIRTY, &att_cleaner);
+  assert(att_.GetLength(ATTEntry::CLEAN) +
+      att_.GetLength(ATTEntry::FREE) == att_.length());
+  pf.AddTableOp(); // assumed in parallel
+
+  ++ckpt_epochs_;
+
+  if (snapshot_meta_) SnapshotMeta();
+  att_.ClearStats(pf);
+  WriteBackPages(ckpt_blocks, pf);
+  migrator_.Clear(pf);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::WriteBackPages(
+    std::vector<Addr>& ckpt_blocks, Profiler& pf) {
+  for (const auto& pair : migrator_.entries()) {
+    const PTTEntry& page = pair.second;
+    // Epoch write-backs go to the alternate copy, which misses
+    // blocks written in this and the last dirty epochs.
+    const uint64_t blocks = page.dirty_blocks | page.stale_blocks;
+    if (page.state == PTTEntry::DIRTY_DIRECT) {
+      pf.AddBlockMoveInter(CopyPageBlocks(pair.first, CacheBase(page),
+          blocks, ckpt_blocks));
+    } else if (page.state == PTTEntry::DIRTY_STATIC) {
+      pf.AddBlockMoveInter(CopyPageBlocks(BackupBase(page), CacheBase(page),
+          blocks, ckpt_blocks));
+    }
+  }
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::SnapshotMeta() {
+  ckpt_meta_.blocks.clear();
+  for (const ATTEntry& entry : att_.entries()) {
+    if (entry.state != ATTEntry::CLEAN) continue;
+    ckpt_meta_.blocks[entry.phy_tag] = entry.mach_base;
+  }
+  // Pages as cleared by the write-back
+  ckpt_meta_.pages.clear();
+  for (const auto& pair : migrator_.entries()) {
+    const PTTEntry::State state = pair.second.state;
+    MetaSnapshot::Page page = { pair.first, state,
+        BackupBase(pair.second) };
+    if (state == PTTEntry::DIRTY_DIRECT) {
+      page.state = PTTEntry::CLEAN_DIRECT;
+    } else if (state == PTTEntry::DIRTY_STATIC) {
+      page.state = PTTEntry::CLEAN_STATIC;
+    }
+    ckpt_meta_.pages.push_back(page);
+  }
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::FinishCheckpointing() {
+  assert(in_checkpointing());
+  nvm_buffer_.ClearBackup(null_pf_); //TODO
+  migrator_.FinishWriteBack();
+  --ckpt_epochs_;
+  mem_store_->OnEpochEnd();
+}
+
+template <class Store>
+int BasicAddrTransController<Store>::Setup(Addr phy_addr, Addr mach_base,
+    ATTEntry::State state, bool move_data, Profiler& pf) {
+  assert(state == ATTEntry::DIRTY || state == ATTEntry::STAINED
+      || state == ATTEntry::LOAN);
+
+  const Tag phy_tag = att_.ToTag(phy_addr);
+  if (move_data) {
+    CopyBlockIntra(mach_base, att_.ToAddr(phy_tag), pf);
+  }
+  return att_.Setup(phy_tag, mach_base, state, pf);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::HideClean(int index, bool move_data,
+    Profiler& pf) {
+  assert(!in_checkpointing());
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::CLEAN);
+
+  const Addr phy_addr = att_.ToAddr(entry.phy_tag);
+
+  if (move_data) {
+#ifdef MEMCK
+    assert(!IsDRAM(phy_addr, null_pf_));
+#endif
+    CopyBlockIntra(phy_addr, entry.mach_base, pf);
+  }
+  if (!IsZeroVersion(entry)) {
+    nvm_buffer_.SlotBackup(entry.mach_base, VersionBuffer::BACKUP0, pf);
+  }
+  att_.Reset(index, phy_addr, ATTEntry::HIDDEN, overlap_pf_);
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::ResetClean(int index, bool move_data,
+    Profiler& pf) {
+  assert(in_checkpointing());
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::CLEAN);
+
+  const Addr mach_base = dram_buffer_.SlotAlloc(pf);
+  if (move_data) {
+    CopyBlockInter(mach_base, entry.mach_base, pf);
+  }
+  if (!IsZeroVersion(entry)) {
+    nvm_buffer_.SlotBackup(entry.mach_base,
+        VersionBuffer::Backup(ckpt_epochs_), pf);
+  }
+  att_.Reset(index, mach_base, ATTEntry::TEMP, overlap_pf_);
+  return mach_base;
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::FreeClean(int index, Profiler& pf) {
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::CLEAN);
+
+  Addr phy_addr = att_.ToAddr(entry.phy_tag);
+  Addr backup = entry.mach_base;
+ 
+  if (in_checkpointing()) {
+    if (IsZeroVersion(entry)) {
+      // The home block still backs up epochs in checkpointing.
+      backup = nvm_buffer_.SlotAlloc(pf);
+      CopyBlockIntra(backup, phy_addr, pf);
+      CopyBlockIntra(phy_addr, zero_base_, pf);
+    } else {
+      SwapBlock(phy_addr, entry.mach_base, pf);
+    }
+    mem_store_->OnCleanFreed(phy_addr, backup);
+  } else { // in running
+    CopyBlockIntra(phy_addr, entry.mach_base, pf);
+    if (IsZeroVersion(entry)) backup = INVAL_ADDR;
+  }
+  if (backup != INVAL_ADDR) {
+    nvm_buffer_.SlotBackup(backup, VersionBuffer::Backup(ckpt_epochs_), pf);
+  }
+  att_.ShiftState(index, ATTEntry::FREE, overlap_pf_);
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::DirtyStained(int index, bool move_data,
+    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+  // TEMP only at the end of an epoch with others in checkpointing
+  assert(!in_checkpointing() || ckpt_blocks);
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::STAINED ||
+      (entry.state == ATTEntry::TEMP && ckpt_blocks));
+
+  const Addr mach_base = nvm_buffer_.SlotAlloc(pf);
+  if (move_data) {
+    CopyBlockInter(mach_base, entry.mach_base, pf);
+    if (ckpt_blocks) ckpt_blocks->push_back(mach_base);
+  }
+  dram_buffer_.FreeSlot(entry.mach_base, VersionBuffer::IN_USE, pf);
+  att_.Reset(index, mach_base, ATTEntry::DIRTY, overlap_pf_);
+  return mach_base;
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::FreeLoan(int index, bool move_data,
+    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+  assert(!in_checkpointing() || ckpt_blocks); // or at the end of an epoch
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::LOAN);
+
+  const Addr phy_addr = att_.ToAddr(entry.phy_tag);
+
+  if (move_data) {
+    const PTTEntry page = migrator_.LookupPage(phy_addr, null_pf_);
+    assert(page.index >= 0);
+    const Addr cache_addr = migrator_.Translate(phy_addr, CacheBase(page));
+    CopyBlockIntra(cache_addr, entry.mach_base, pf);
+    if (ckpt_blocks) ckpt_blocks->push_back(cache_addr);
+  }
+  dram_buffer_.FreeSlot(entry.mach_base, VersionBuffer::IN_USE, pf);
+  att_.ShiftState(index, ATTEntry::FREE, overlap_pf_);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::HideTemp(int index, bool move_data,
+    Profiler& pf, std::vector<Addr>* ckpt_blocks) {
+  assert(!in_checkpointing());
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::TEMP);
+
+  const Addr phy_addr = att_.ToAddr(entry.phy_tag);
+  if (move_data) {
+    assert(!IsDRAM(phy_addr, null_pf_));
+    CopyBlockInter(phy_addr, entry.mach_base, pf);
+    if (ckpt_blocks) ckpt_blocks->push_back(phy_addr);
+  }
+  dram_buffer_.FreeSlot(entry.mach_base, VersionBuffer::IN_USE, pf);
+  att_.Reset(index, phy_addr, ATTEntry::HIDDEN, overlap_pf_);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::Discard(int index, VersionBuffer& vb,
+    Profiler& pf) {
+  assert(!in_checkpointing());
+  const ATTEntry& entry = att_.At(index);
+  if (!IsZeroVersion(entry)) {
+    vb.FreeSlot(entry.mach_base, VersionBuffer::IN_USE, overlap_pf_);
+  }
+  att_.ShiftState(index, ATTEntry::FREE, pf);
+}
+
+template <class Store>
+bool BasicAddrTransController<Store>::ElideZero(int index, VersionBuffer& vb) {
+  const ATTEntry& entry = att_.At(index);
+  assert(entry.state == ATTEntry::DIRTY || entry.state == ATTEntry::STAINED ||
+      entry.state == ATTEntry::TEMP);
+  if (!mem_store_->IsZero(entry.mach_base, att_.block_size())) return false;
+
+  vb.FreeSlot(entry.mach_base, VersionBuffer::IN_USE, overlap_pf_);
+  att_.Reset(index, zero_base_, ATTEntry::CLEAN, overlap_pf_);
+  ++zero_blocks_;
+  return true;
+}
+
+template <class Store>
+Addr BasicAddrTransController<Store>::UntrackedAddr(Addr phy_addr) {
+  int index = att_.Lookup(att_.ToTag(phy_addr), null_pf_);
+  if (index != -EINVAL && IsZeroVersion(att_.At(index))) {
+    const Addr mach_base = nvm_buffer_.SlotAlloc(null_pf_);
+    mem_store_->MemCopy(mach_base, zero_base_, att_.block_size());
+    att_.Rebase(index, mach_base, null_pf_);
+  }
+  return LoadAddr(phy_addr, null_pf_);
+}
+
+template <class Store>
+void BasicAddrTransController<Store>::UntrackedStore(Addr phy_addr,
+    Addr mach_addr, int size) {
+  const PTTEntry page = migrator_.LookupPage(phy_addr, null_pf_);
+  if (page.index < 0) return;
+  mem_store_->MemCopy(phy_addr, mach_addr, size);
+  mem_store_->MemCopy(migrator_.Translate(phy_addr, BackupBase(page)),
+      mach_addr, size);
+}
+
+#ifdef MEMCK
+template <class Store>
+  std::pair<AddrInfo, AddrInfo> BasicAddrTransController<Store>::GetAddrInfo(
+      Addr phy_addr) {
+    std::pair<AddrInfo, AddrInfo> info;
+
+    int index = att_.Lookup(phy_addr, null_pf_);
+    if (index != -EINVAL) {
+      const ATTEntry& entry = att_.At(index);
+      info.first = { att_.ToAddr(entry.phy_tag), entry.mach_base,
+          entry.StateString() };
+    } else {
+      info.first = { 0, 0, NULL };
+    }
+
+    PTTEntry* p = migrator_.LookupPage(phy_addr, null_pf_);
+    if (p) {
+      info.second = { migrator_.PageAlign(phy_addr), p->mach_base,
+          p->StateString() };
+    } else {
+      info.second = { 0, 0, NULL };
+    }
+
+    return info;
+  }
+#endif
+
+#endif // SEXAIN_ADDR_TRANS_CONTROLLER_IMPL_H_
@@ -36,6 +36,7 @@ int AddrTransTable::Setup(Tag phy_tag, Addr mach_base, ATTEntry::State state,
   entries_[i].mach_base = mach_base;
 
   tag_index_[phy_tag] = i;
+  meta_.Mark(i);
   pf.AddTableOp();
   return i;
 }
@@ -50,6 +51,7 @@ void AddrTransTable::ShiftState(int index, ATTEntry::State new_state,
   GetQueue(entry.state).Remove(index);
   GetQueue(new_state).PushBack(index);
   entries_[index].state = new_state;
+  meta_.Mark(index);
   pf.AddTableOp();
 }
 
@@ -60,6 +62,12 @@ void AddrTransTable::Reset(int index,
   ShiftState(index, new_state, pf);
 }
 
+void AddrTransTable::Rebase(int index, Addr new_base, Profiler& pf) {
+  entries_[index].mach_base = new_base;
+  meta_.Mark(index);
+  pf.AddTableOp();
+}
+
 void AddrTransTable::ClearStats(Profiler& pf) {
   for (vector<ATTEntry>::iterator it = entries_.begin(); it != entries_.end();
       ++it) {
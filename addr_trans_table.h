@@ -10,6 +10,7 @@
 #include <unordered_map>
 #include <initializer_list>
 #include "index_queue.h"
+#include "meta_tracker.h"
 #include "profiler.h"
 
 typedef int64_t Tag; // never negative
@@ -56,8 +57,13 @@ class AddrTransTable : public IndexArray {
   int Setup(Tag phy_tag, Addr mach_base, ATTEntry::State state, Profiler& pf);
   void ShiftState(int index, ATTEntry::State state, Profiler& pf);
   void Reset(int index, Addr new_base, ATTEntry::State new_state, Profiler& pf);
-  int VisitQueue(ATTEntry::State state, QueueVisitor* visitor);
-  bool Contains(Addr phy_addr, Profiler& pf) const;
+  void Rebase(int index, Addr new_base, Profiler& pf);
+  template <class Visitor>
+  int VisitQueue(ATTEntry::State state, Visitor* visitor);
+  bool Contains(Tag phy_tag, Profiler& pf) const;
+  /// Index of the entry as a hint, not counted as a table operation
+  /// nor touching the LRU order (-EINVAL if not found)
+  int Find(Tag phy_tag) const;
 
   const ATTEntry& At(int i) const;
   bool IsEmpty(ATTEntry::State state) const;
@@ -77,6 +83,12 @@ class AddrTransTable : public IndexArray {
   void ClearStats(Profiler& pf);
   const std::vector<ATTEntry>& entries() const { return entries_; }
 
+  /// Adds the table blocks modified since the last call to the list
+  int FlushMeta(Addr base, std::vector<Addr>* list) {
+    return meta_.Flush(base, list);
+  }
+  const MetaTracker& meta() const { return meta_; }
+
   IndexNode& operator[](int i) { return entries_[i].queue_node; }
   const IndexQueue& GetQueue(ATTEntry::State state) const;
 
@@ -87,13 +99,15 @@ class AddrTransTable : public IndexArray {
   std::unordered_map<Tag, int> tag_index_;
   std::vector<ATTEntry> entries_;
   std::vector<IndexQueue> queues_;
+  MetaTracker meta_;
 
   IndexQueue& GetQueue(ATTEntry::State state);
 };
 
 inline AddrTransTable::AddrTransTable(int length, int block_bits) :
     length_(length), block_bits_(block_bits), block_mask_(block_size() - 1),
-    entries_(length_), queues_(ATTEntry::DIRTY + 1, *this) {
+    entries_(length_), queues_(ATTEntry::DIRTY + 1, *this),
+    meta_(length_, block_bits_) {
   for (int i = 0; i < length_; ++i) {
     GetQueue(ATTEntry::FREE).PushBack(i);
   }
@@ -104,13 +118,19 @@ inline const ATTEntry& AddrTransTable::At(int i) const {
   return entries_[i];
 }
 
-inline bool AddrTransTable::Contains(Addr phy_addr, Profiler& pf) const {
+inline bool AddrTransTable::Contains(Tag phy_tag, Profiler& pf) const {
   pf.AddTableOp();
-  return tag_index_.find(Tag(phy_addr)) != tag_index_.end();
+  return tag_index_.find(phy_tag) != tag_index_.end();
+}
+
+inline int AddrTransTable::Find(Tag phy_tag) const {
+  std::unordered_map<Tag, int>::const_iterator it = tag_index_.find(phy_tag);
+  return it == tag_index_.end() ? -EINVAL : it->second;
 }
 
+template <class Visitor>
 inline int AddrTransTable::VisitQueue(ATTEntry::State state,
-    QueueVisitor* visitor) {
+    Visitor* visitor) {
   assert(state <= ATTEntry::DIRTY);
   return GetQueue(state).Accept(visitor);
 }
@@ -0,0 +1,299 @@
+// core_bench.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+//
+// Host throughput of the controller core under synthetic patterns,
+// with optional comparison against a saved baseline.
+
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "addr_trans_controller.h"
+#include "version_buffer.h"
+#include "index_queue.h"
+#include "host_store.h"
+#include "patterns.h"
+
+using namespace std;
+
+#define K (1024)
+#define M (1024 * K)
+
+typedef chrono::steady_clock Clock;
+
+const int kBlockBits = 6;
+const int kPageBits = 12;
+const uint64_t kPhySize = 64 * M;
+const uint64_t kDRAMSize = 16 * M;
+const double kWriteRatio = 0.33;
+const int kATTLengths[] = { 1024, 4096, 16384 };
+const char* kPatterns[] = { "seq", "uniform", "zipf", "slid" };
+
+// Metrics are times, so lower is better.
+// Each keeps the minimum over repeated runs to filter out host noise.
+class Metrics {
+ public:
+  void Add(const string& name, double value, const string& note = "");
+  void Print() const;
+  const vector<pair<string, double>>& values() const { return values_; }
+ private:
+  vector<pair<string, double>> values_;
+  map<string, string> notes_;
+};
+
+void Metrics::Add(const string& name, double value, const string& note) {
+  for (pair<string, double>& m : values_) {
+    if (m.first == name) {
+      m.second = min(m.second, value);
+      return;
+    }
+  }
+  values_.push_back(make_pair(name, value));
+  if (!note.empty()) notes_[name] = note;
+}
+
+void Metrics::Print() const {
+  for (const pair<string, double>& m : values_) {
+    map<string, string>::const_iterator it = notes_.find(m.first);
+    cout << setw(32) << left << m.first << right << setw(10) << m.second
+        << (it == notes_.end() ? "" : "  " + it->second) << endl;
+  }
+}
+
+double Nanos(Clock::duration d) {
+  return chrono::duration<double, nano>(d).count();
+}
+
+unique_ptr<Pattern> MakePattern(const string& name, uint64_t num_blocks,
+    int att_len, uint64_t seed) {
+  if (name == "seq") {
+    return unique_ptr<Pattern>(new SequentialPattern(num_blocks, seed));
+  } else if (name == "uniform") {
+    return unique_ptr<Pattern>(new UniformPattern(num_blocks, seed));
+  } else if (name == "zipf") {
+    return unique_ptr<Pattern>(new ZipfianPattern(num_blocks, 0.99, seed));
+  } else {
+    return unique_ptr<Pattern>(
+        new SlidingPattern(num_blocks, att_len, 4, seed));
+  }
+}
+
+// Loads and stores through the gem5 instantiation of the controller.
+// Epoch transitions (MigratePages, BeginCheckpointing and
+// FinishCheckpointing) are timed apart from regular accesses.
+void BenchTrans(const string& name, int att_len, uint64_t num_ops,
+    Metrics& metrics) {
+  const int block_size = 1 << kBlockBits;
+  VirtualStore store(0);
+  AddrTransController atc(kPhySize, kDRAMSize,
+      att_len, kBlockBits, kPageBits, &store);
+  store.Resize(atc.Size());
+  // Seeded apart, or the write coin follows the addresses drawn
+  unique_ptr<Pattern> pattern =
+      MakePattern(name, kPhySize >> kBlockBits, att_len, 2);
+
+  Profiler base(kBlockBits, kPageBits);
+  base.set_op_latency(1);
+  mt19937_64 rand(1);
+  bernoulli_distribution is_write(kWriteRatio);
+
+  vector<Addr> ckpt_blocks;
+  uint64_t epochs = 0;
+  uint64_t ckpt_size = 0;
+  Clock::duration epoch_time(0);
+  Clock::time_point begin = Clock::now();
+  for (uint64_t i = 0; i < num_ops; ++i) {
+    const Addr phy_addr = pattern->Next() << kBlockBits;
+    Profiler pf(base);
+    if (is_write(rand)) {
+      if (atc.Probe(phy_addr) == NEW_EPOCH) {
+        Clock::time_point e = Clock::now();
+        atc.MigratePages(ckpt_blocks, pf);
+        atc.BeginCheckpointing(ckpt_blocks, pf);
+        atc.FinishCheckpointing();
+        epoch_time += Clock::now() - e;
+        ckpt_size += ckpt_blocks.size();
+        ckpt_blocks.clear();
+        ++epochs;
+      }
+      atc.StoreAddr(phy_addr, block_size, pf);
+    } else {
+      atc.LoadAddr(phy_addr, pf);
+    }
+  }
+  Clock::duration total = Clock::now() - begin;
+
+  const string prefix = "trans." + name + ".att" + to_string(att_len);
+  metrics.Add(prefix + ".ns_op", Nanos(total - epoch_time) / num_ops,
+      "epochs=" + to_string(epochs));
+  if (epochs) {
+    metrics.Add(prefix + ".us_epoch", Nanos(epoch_time) / epochs / 1000,
+        "blocks/ckpt=" + to_string(ckpt_size / epochs));
+  }
+}
+
+// Slot life cycle of the NVM version buffer within epochs:
+// allocation by writes, backup at checkpointing, then reclamation.
+void BenchVersionBuffer(int length, uint64_t num_ops, Metrics& metrics) {
+  VersionBuffer buffer(length, kBlockBits);
+  buffer.set_addr_base(kPhySize);
+  Profiler pf(kBlockBits, kPageBits);
+  vector<uint64_t> slots(length / 2);
+  uint64_t ops = 0;
+
+  Clock::time_point begin = Clock::now();
+  while (ops < num_ops) {
+    for (uint64_t& s : slots) s = buffer.SlotAlloc(pf);
+    for (uint64_t s : slots) buffer.SlotBackup(s, VersionBuffer::BACKUP1, pf);
+    buffer.ClearBackup(pf);
+    ops += 2 * slots.size() + 1;
+  }
+  metrics.Add("vbuf." + to_string(length) + ".ns_op",
+      Nanos(Clock::now() - begin) / ops);
+}
+
+class NodeArray : public IndexArray {
+ public:
+  NodeArray(int length) : nodes_(length) { }
+  IndexNode& operator[](int i) { return nodes_[i]; }
+ private:
+  vector<IndexNode> nodes_;
+};
+
+struct CountVisitor {
+  uint64_t sum = 0;
+  void Visit(int i) { sum += i; }
+};
+
+// LRU-style touches (Remove + PushBack) plus full queue walks
+void BenchIndexQueue(int length, uint64_t num_ops, Metrics& metrics) {
+  NodeArray nodes(length);
+  IndexQueue queue(nodes);
+  for (int i = 0; i < length; ++i) queue.PushBack(i);
+
+  mt19937_64 rand(1);
+  uniform_int_distribution<int> dist(0, length - 1);
+  Clock::time_point begin = Clock::now();
+  for (uint64_t i = 0; i < num_ops; ++i) {
+    const int n = dist(rand);
+    queue.Remove(n);
+    queue.PushBack(n);
+  }
+  const double ns_op = Nanos(Clock::now() - begin) / num_ops;
+
+  CountVisitor visitor;
+  const uint64_t walks = num_ops / length + 1;
+  begin = Clock::now();
+  for (uint64_t i = 0; i < walks; ++i) queue.Accept(&visitor);
+  const double ns_visit = Nanos(Clock::now() - begin) / (walks * length);
+  if (visitor.sum == 0 && length > 1) cerr << "Empty walks!" << endl;
+
+  const string prefix = "iq." + to_string(length);
+  metrics.Add(prefix + ".ns_op", ns_op);
+  metrics.Add(prefix + ".ns_visit", ns_visit);
+}
+
+map<string, double> LoadMetrics(const string& file) {
+  map<string, double> metrics;
+  ifstream in(file);
+  string name;
+  double value;
+  while (in >> name >> value) metrics[name] = value;
+  return metrics;
+}
+
+// Returns the number of metrics slower than the baseline beyond tolerance.
+int Compare(const Metrics& metrics, const map<string, double>& baseline,
+    double tolerance) {
+  int regressions = 0;
+  cout << endl << "Versus baseline (tolerance " << tolerance * 100 << "%):"
+      << endl;
+  for (const pair<string, double>& m : metrics.values()) {
+    map<string, double>::const_iterator it = baseline.find(m.first);
+    if (it == baseline.end() || it->second <= 0) continue;
+    const double ratio = m.second / it->second;
+    const bool slower = ratio > 1 + tolerance;
+    regressions += slower;
+    cout << setw(32) << left << m.first << right << setw(10) << it->second
+        << setw(10) << m.second << setw(8) << fixed << setprecision(2)
+        << ratio << defaultfloat << setprecision(4)
+        << (slower ? "  REGRESSION" : "") << endl;
+  }
+  return regressions;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t num_ops = M;
+  string baseline_file, save_file;
+  double tolerance = 0.1;
+  int reps = 3;
+
+  int c;
+  while ((c = getopt(argc, argv, "n:r:b:s:t:")) != -1) {
+    switch (c) {
+    case 'n':
+      num_ops = atol(optarg) * K;
+      break;
+    case 'r':
+      reps = atoi(optarg);
+      break;
+    case 'b':
+      baseline_file = optarg;
+      break;
+    case 's':
+      save_file = optarg;
+      break;
+    case 't':
+      tolerance = atof(optarg);
+      break;
+    default:
+      cout << "Usage: " << argv[0] << " [-n NUM of ops in Ks]"
+          " [-r REPEATS] [-b BASELINE file] [-s SAVE file]"
+          " [-t TOLERANCE ratio]" << endl;
+      return -1;
+    }
+  }
+
+  Metrics metrics;
+  for (int r = 0; r < reps; ++r) {
+    for (const char* p : kPatterns) {
+      for (int att_len : kATTLengths) {
+        BenchTrans(p, att_len, num_ops, metrics);
+      }
+    }
+    for (int att_len : kATTLengths) {
+      BenchVersionBuffer(2 * att_len, num_ops, metrics);
+    }
+    for (int att_len : kATTLengths) {
+      BenchIndexQueue(att_len, num_ops, metrics);
+    }
+  }
+  cout << setprecision(4);
+  metrics.Print();
+
+  if (!save_file.empty()) {
+    ofstream out(save_file);
+    for (const pair<string, double>& m : metrics.values()) {
+      out << m.first << ' ' << m.second << endl;
+    }
+  }
+  if (!baseline_file.empty()) {
+    map<string, double> baseline = LoadMetrics(baseline_file);
+    if (baseline.empty()) {
+      cerr << "No baseline metrics in " << baseline_file << endl;
+      return -1;
+    }
+    return Compare(metrics, baseline, tolerance) ? 1 : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// host_store.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_HOST_STORE_H_
+#define SEXAIN_HOST_STORE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "mem_store.h"
+
+// Host memory backing the machine address space, with callbacks
+// cheap enough that the controller itself dominates.
+// The Base is either MemStore (virtual) or HostBase (non-virtual).
+struct HostBase { };
+
+template <class Base>
+class HostStore : public Base {
+ public:
+  HostStore(uint64_t size) : data_(size), num_writes_(0), num_ops_(0) { }
+
+  /// Sizes the space as a controller set up on the store lays it out
+  void Resize(uint64_t size) { data_.resize(size); }
+
+  void MemCopy(uint64_t direct_addr, uint64_t mach_addr, int size) {
+    memcpy(&data_[direct_addr], &data_[mach_addr], size);
+  }
+
+  void MemSwap(uint64_t direct_addr, uint64_t mach_addr, int size) {
+    std::swap_ranges(&data_[direct_addr], &data_[direct_addr] + size,
+        &data_[mach_addr]);
+  }
+
+  // Benchmarks write no data, so no version is elided as zeros.
+  bool IsZero(uint64_t mach_addr, int size) { return false; }
+
+  void OnATTOp() { ++num_ops_; }
+  void OnBufferOp() { ++num_ops_; }
+  int64_t GetReadLatency(uint64_t mach_addr, bool dram,
+      const PTTEntry* page) { return dram ? 50 : 100; }
+  int64_t GetWriteLatency(uint64_t mach_addr, bool dram,
+      const PTTEntry* page) { return dram ? 50 : 300; }
+  int64_t GetMetaLatency(uint64_t meta_addr, bool hit) {
+    return hit ? 2 : 50;
+  }
+
+  void OnNVMRead(uint64_t mach_addr, int size) { }
+  void OnNVMStore(uint64_t phy_addr, int size) { }
+  void OnDRAMRead(uint64_t mach_addr, int size) { }
+  void OnDRAMStore(uint64_t phy_addr, int size) { }
+  void OnCleanFreed(uint64_t phy_addr, uint64_t mach_base) { }
+
+  void OnEpochEnd() { }
+  void OnATTWriteHit(int state) { ++num_ops_; }
+  void OnATTWriteMiss(int state) { ++num_ops_; }
+
+  void OnCacheRegister() { }
+  void statsNVMWrites(int n = 1) { num_writes_ += n; }
+  void statsDRAMWrites(int n = 1) { num_writes_ += n; }
+  void ckDRAMWriteHit() { }
+
+  uint64_t num_writes() const { return num_writes_; }
+  char* data() { return &data_[0]; }
+
+ private:
+  std::vector<char> data_;
+  uint64_t num_writes_;
+  uint64_t num_ops_;
+};
+
+typedef HostStore<MemStore> VirtualStore;
+typedef HostStore<HostBase> DirectStore;
+
+#endif // SEXAIN_HOST_STORE_H_
@@ -0,0 +1,120 @@
+// patterns.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_PATTERNS_H_
+#define SEXAIN_PATTERNS_H_
+
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+// Synthetic block-index streams over [0, num_blocks),
+// mirroring the access patterns of the guest benchmarks.
+class Pattern {
+ public:
+  Pattern(uint64_t num_blocks, uint64_t seed) :
+      num_blocks_(num_blocks), rand_(seed) { }
+  virtual ~Pattern() { }
+  virtual uint64_t Next() = 0;
+  uint64_t num_blocks() const { return num_blocks_; }
+ protected:
+  const uint64_t num_blocks_;
+  std::mt19937_64 rand_;
+};
+
+// As array_strm
+class SequentialPattern : public Pattern {
+ public:
+  SequentialPattern(uint64_t num_blocks, uint64_t seed = 1) :
+      Pattern(num_blocks, seed), cursor_(0) { }
+  uint64_t Next() {
+    uint64_t b = cursor_;
+    if (++cursor_ == num_blocks_) cursor_ = 0;
+    return b;
+  }
+ private:
+  uint64_t cursor_;
+};
+
+// As array_rand and hash_table
+class UniformPattern : public Pattern {
+ public:
+  UniformPattern(uint64_t num_blocks, uint64_t seed = 1) :
+      Pattern(num_blocks, seed), dist_(0, num_blocks - 1) { }
+  uint64_t Next() { return dist_(rand_); }
+ private:
+  std::uniform_int_distribution<uint64_t> dist_;
+};
+
+// Skewed popularity as in key-value stores (Gray et al., SIGMOD'94).
+// Ranks are scattered over the space so hot blocks span many pages.
+class ZipfianPattern : public Pattern {
+ public:
+  ZipfianPattern(uint64_t num_blocks, double theta = 0.99,
+      uint64_t seed = 1);
+  uint64_t Next();
+ private:
+  const double theta_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+  std::uniform_real_distribution<double> dist_;
+};
+
+// As array_slid: a window of blocks swept repeatedly,
+// then shifted by its own length
+class SlidingPattern : public Pattern {
+ public:
+  SlidingPattern(uint64_t num_blocks, uint64_t window, int sweeps,
+      uint64_t seed = 1) : Pattern(num_blocks, seed), window_(window),
+      sweeps_(sweeps), base_(0), offset_(0), sweep_(0) { }
+  uint64_t Next();
+ private:
+  const uint64_t window_;
+  const int sweeps_;
+  uint64_t base_;
+  uint64_t offset_;
+  int sweep_;
+};
+
+inline ZipfianPattern::ZipfianPattern(uint64_t num_blocks, double theta,
+    uint64_t seed) : Pattern(num_blocks, seed), theta_(theta), dist_(0, 1) {
+  zeta_n_ = 0;
+  for (uint64_t i = 1; i <= num_blocks_; ++i) {
+    zeta_n_ += 1 / std::pow(i, theta_);
+  }
+  const double zeta_2 = 1 + 1 / std::pow(2, theta_);
+  alpha_ = 1 / (1 - theta_);
+  eta_ = (1 - std::pow(2.0 / num_blocks_, 1 - theta_)) /
+      (1 - zeta_2 / zeta_n_);
+}
+
+inline uint64_t ZipfianPattern::Next() {
+  const double u = dist_(rand_);
+  const double uz = u * zeta_n_;
+  uint64_t rank;
+  if (uz < 1) {
+    rank = 0;
+  } else if (uz < 1 + std::pow(0.5, theta_)) {
+    rank = 1;
+  } else {
+    rank = num_blocks_ * std::pow(eta_ * u - eta_ + 1, alpha_);
+    if (rank >= num_blocks_) rank = num_blocks_ - 1;
+  }
+  // An odd multiplier permutes a power-of-two space.
+  return (rank * 0x9E3779B97F4A7C15ull) % num_blocks_;
+}
+
+inline uint64_t SlidingPattern::Next() {
+  uint64_t b = (base_ + offset_) % num_blocks_;
+  if (++offset_ == window_) {
+    offset_ = 0;
+    if (++sweep_ == sweeps_) {
+      sweep_ = 0;
+      base_ = (base_ + window_) % num_blocks_;
+    }
+  }
+  return b;
+}
+
+#endif // SEXAIN_PATTERNS_H_
@@ -0,0 +1,324 @@
+// recovery_test.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+//
+// Power failure checks of the controller core. Checkpoints finish a while
+// after they begin, so that up to depth - 1 of them are in flight, and
+// recovery at those points has to rebuild the image of the last finished
+// checkpoint only from what the controller has written.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <algorithm>
+#include <numeric>
+#include <deque>
+#include <random>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+#include "addr_trans_controller_impl.h"
+#include "crash_recovery.h"
+#include "host_store.h"
+
+using namespace std;
+
+#define K (1024)
+#define M (1024 * K)
+
+const int kBlockBits = 6;
+const int kPageBits = 12;
+const uint64_t kPhySize = 8 * M;
+const uint64_t kDRAMSize = 2 * M;
+const int kStreamBlocks = 8;
+
+// Keeps real contents, so that zero versions are elided, and passes the
+// blocks remapped in checkpointing on to the recovery model.
+class RecoveryStore : public DirectStore {
+ public:
+  RecoveryStore(CrashRecovery* recovery) :
+      DirectStore(0), recovery_(recovery) { }
+
+  bool IsZero(uint64_t mach_addr, int size) {
+    const char* block = data() + mach_addr;
+    return !block[0] && !memcmp(block, block + 1, size - 1);
+  }
+
+  void OnCleanFreed(uint64_t phy_addr, uint64_t mach_base) {
+    recovery_->OnCleanFreed(phy_addr >> kBlockBits, mach_base);
+  }
+
+ private:
+  CrashRecovery* recovery_;
+};
+
+typedef BasicAddrTransController<RecoveryStore> Controller;
+
+struct Config {
+  int depth;
+  int lag; ///< Ops from the beginning to the end of a checkpoint
+  int att_len;
+};
+
+struct Result {
+  uint64_t epochs;
+  uint64_t recoveries[3]; ///< By checkpoints in flight, capped at two
+  uint64_t mismatches[3];
+  uint64_t read_errors;
+};
+
+class Tester {
+ public:
+  Tester(int depth, int att_len, int lag);
+
+  /// Moves on to op @now, finishing the checkpoints due
+  void Advance(uint64_t now);
+  void BeginEpoch();
+  void FinishCheckpoint();
+  /// Ends the epoch or waits for checkpoints as the controller asks
+  void Write(Addr phy_addr, uint64_t value);
+  /// Returns false if the data read is not the data last written
+  bool Read(Addr phy_addr);
+  RecoveryStats Recover() {
+    return recovery_.Recover((const uint8_t*)store_.data());
+  }
+
+  const Controller& controller() const { return atc_; }
+  int in_flight() const { return atc_.ckpt_epochs(); }
+  uint64_t epochs() const { return epochs_; }
+
+ private:
+  CrashRecovery recovery_;
+  RecoveryStore store_;
+  Controller atc_;
+  Profiler base_;
+  vector<Addr> ckpt_blocks_;
+  unordered_map<Addr, uint64_t> values_;
+  const int lag_;
+  uint64_t now_;
+  deque<uint64_t> finishes_; ///< Ops at which checkpoints finish
+  uint64_t epochs_;
+};
+
+Tester::Tester(int depth, int att_len, int lag) :
+    recovery_(kPhySize, kBlockBits, kPageBits), store_(&recovery_),
+    atc_(kPhySize, kDRAMSize, att_len, kBlockBits, kPageBits, &store_, depth),
+    base_(kBlockBits, kPageBits), lag_(lag), now_(0), epochs_(0) {
+  store_.Resize(atc_.Size());
+  atc_.set_meta_snapshot(true);
+  atc_.set_stream_blocks(kStreamBlocks);
+  base_.set_op_latency(1);
+}
+
+void Tester::Advance(uint64_t now) {
+  now_ = now;
+  while (!finishes_.empty() && finishes_.front() <= now_) {
+    FinishCheckpoint();
+  }
+}
+
+void Tester::BeginEpoch() {
+  Profiler pf(base_);
+  atc_.MigratePages(ckpt_blocks_, pf);
+  atc_.BeginCheckpointing(ckpt_blocks_, pf);
+  recovery_.OnCheckpointBegin(atc_.ckpt_meta());
+  ckpt_blocks_.clear();
+  finishes_.push_back(now_ + lag_);
+  ++epochs_;
+}
+
+void Tester::FinishCheckpoint() {
+  atc_.FinishCheckpointing();
+  recovery_.OnCheckpointFinish();
+  finishes_.pop_front();
+}
+
+void Tester::Write(Addr phy_addr, uint64_t value) {
+  Control control = atc_.Probe(phy_addr);
+  while (control == WAIT_CKPT) {
+    FinishCheckpoint();
+    control = atc_.Probe(phy_addr);
+  }
+  if (control == NEW_EPOCH) BeginEpoch();
+
+  const int block_size = 1 << kBlockBits;
+  Profiler pf(base_);
+  const Addr mach_addr = atc_.StoreAddr(phy_addr, block_size, pf);
+  uint64_t block[block_size / sizeof(uint64_t)];
+  for (uint64_t& word : block) word = value;
+  memcpy(store_.data() + mach_addr, block, block_size);
+  recovery_.OnStore(phy_addr, (const uint8_t*)block, block_size);
+  values_[phy_addr] = value;
+}
+
+bool Tester::Read(Addr phy_addr) {
+  Profiler pf(base_);
+  const Addr mach_addr = atc_.LoadAddr(phy_addr, pf);
+  unordered_map<Addr, uint64_t>::iterator it = values_.find(phy_addr);
+  uint64_t value;
+  memcpy(&value, store_.data() + mach_addr, sizeof(value));
+  return it == values_.end() || it->second == value;
+}
+
+// A sequential stream with jumps, uniform writes and a hot set, half of
+// the values zeros. Recovers every @interval ops.
+Result Run(const Config& config, uint64_t num_ops, int interval,
+    uint64_t seed) {
+  Tester tester(config.depth, config.att_len, config.lag);
+  Result result = { };
+  mt19937_64 rand(seed);
+  const uint64_t num_blocks = kPhySize >> kBlockBits;
+  const uint64_t page_blocks = 1 << (kPageBits - kBlockBits);
+  uint64_t stream = 0;
+
+  for (uint64_t i = 0; i < num_ops; ++i) {
+    tester.Advance(i);
+    if (i % interval == 0) {
+      const RecoveryStats stats = tester.Recover();
+      const int n = min(tester.in_flight(), 2);
+      ++result.recoveries[n];
+      result.mismatches[n] += stats.mismatches;
+    }
+
+    uint64_t block;
+    switch (rand() % 4) {
+    case 0:
+      if (stream % page_blocks == page_blocks - 1 || rand() % 200 == 0) {
+        stream = (rand() % (num_blocks / page_blocks)) * page_blocks;
+      } else {
+        ++stream;
+      }
+      block = stream;
+      break;
+    case 1:
+      block = rand() % num_blocks;
+      break;
+    default:
+      block = rand() % 4096 + 1000;
+      break;
+    }
+    const Addr phy_addr = block << kBlockBits;
+
+    if (rand() % 3) {
+      result.read_errors += !tester.Read(phy_addr);
+      continue;
+    }
+    tester.Write(phy_addr, rand() % 2 ? 0 : rand());
+  }
+
+  while (tester.in_flight()) tester.FinishCheckpoint();
+  const RecoveryStats stats = tester.Recover();
+  ++result.recoveries[0];
+  result.mismatches[0] += stats.mismatches;
+  result.epochs = tester.epochs();
+  return result;
+}
+
+// Power fails at each step of a drain with two epochs in flight. Two
+// pages move in as static at the end of epoch 0, one promoted on a write
+// stream, whose next page is predicted, and the other ranked by dirty
+// ratio, and epoch 1 writes them while checkpoint 0 is in flight. Returns the number of mismatched
+// blocks, or -1 if the steps do not go as planned.
+int CheckDrain() {
+  const int page_blocks = 1 << (kPageBits - kBlockBits);
+  const Addr streamed = Addr(16) << kPageBits;
+  const Addr ranked = Addr(32) << kPageBits;
+  const Addr other = Addr(48) << kPageBits;
+  Tester tester(3, 256, 0);
+  const Controller& atc = tester.controller();
+  mt19937_64 rand(1);
+  vector<int> order(page_blocks);
+  iota(order.begin(), order.end(), 0);
+  shuffle(order.begin(), order.end(), rand); // no stream
+
+  int mismatches = 0;
+  bool two_in_flight = false;
+  for (int step = 0; step < 6; ++step) {
+    switch (step) {
+    case 0:
+      for (int i = 0; i < page_blocks; ++i) {
+        tester.Write(streamed + (i << kBlockBits), rand() | 1);
+        tester.Write(ranked + (order[i] << kBlockBits), rand() | 1);
+      }
+      tester.BeginEpoch();
+      if (atc.pages_streamed() != 2 ||
+          atc.migrator().entries().at(streamed).state !=
+          PTTEntry::CLEAN_STATIC ||
+          atc.migrator().entries().at(ranked).state !=
+          PTTEntry::CLEAN_STATIC) {
+        return -1;
+      }
+      break;
+    case 1:
+      tester.Write(streamed, rand() | 1);
+      tester.Write(ranked + (order[0] << kBlockBits), rand() | 1);
+      break;
+    case 2:
+      while (!atc.ckpt_available()) tester.FinishCheckpoint();
+      tester.BeginEpoch();
+      break;
+    case 3:
+      tester.Write(other, rand() | 1);
+      while (!atc.ckpt_available()) tester.FinishCheckpoint();
+      tester.BeginEpoch();
+      break;
+    default:
+      tester.FinishCheckpoint();
+      break;
+    }
+    two_in_flight |= tester.in_flight() == 2;
+    mismatches += tester.Recover().mismatches;
+  }
+  return two_in_flight ? mismatches : -1;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t num_ops = M;
+  int interval = 997;
+  uint64_t seed = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "n:i:s:")) != -1) {
+    switch (c) {
+    case 'n':
+      num_ops = atol(optarg) * K;
+      break;
+    case 'i':
+      interval = atoi(optarg);
+      break;
+    case 's':
+      seed = atol(optarg);
+      break;
+    default:
+      cout << "Usage: " << argv[0] << " [-n NUM of ops in Ks]"
+          " [-i INTERVAL of recoveries in ops] [-s SEED]" << endl;
+      return -1;
+    }
+  }
+
+  // Lags about an epoch long keep two checkpoints in flight at depth > 2.
+  const Config configs[] = {
+    { 2, 800, 256 }, { 3, 800, 256 }, { 4, 1200, 256 }, { 4, 2000, 512 },
+  };
+  const int drain = CheckDrain();
+  cout << "drain mismatches=" << drain << (drain ? "  FAILED" : "") << endl;
+  int failures = drain != 0;
+  for (const Config& config : configs) {
+    const Result r = Run(config, num_ops, interval, seed);
+    const uint64_t mismatches =
+        r.mismatches[0] + r.mismatches[1] + r.mismatches[2];
+    // Deeper pipelines are only checked if two epochs were in flight.
+    const bool covered = config.depth <= 2 || r.recoveries[2];
+    const bool ok = !mismatches && !r.read_errors && covered;
+    cout << "depth=" << config.depth << " lag=" << config.lag
+        << " att=" << config.att_len << " epochs=" << r.epochs
+        << " recoveries=" << r.recoveries[0] << "/" << r.recoveries[1]
+        << "/" << r.recoveries[2] << " mismatches=" << r.mismatches[0]
+        << "/" << r.mismatches[1] << "/" << r.mismatches[2]
+        << " read_errors=" << r.read_errors
+        << (ok ? "" : covered ? "  FAILED" : "  NOT COVERED") << endl;
+    failures += !ok;
+  }
+  return failures;
+}
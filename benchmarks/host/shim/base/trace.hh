@@ -0,0 +1,11 @@
+// shim/base/trace.hh
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+//
+// Stand-in of the gem5 tracing header for host builds of the controller
+
+#ifndef SEXAIN_SHIM_BASE_TRACE_HH_
+#define SEXAIN_SHIM_BASE_TRACE_HH_
+
+#define DPRINTF(...) do { } while (0)
+
+#endif // SEXAIN_SHIM_BASE_TRACE_HH_
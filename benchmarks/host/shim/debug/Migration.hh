@@ -0,0 +1,9 @@
+// shim/debug/Migration.hh
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+//
+// Stand-in of the gem5 generated debug flag for host builds
+
+#ifndef SEXAIN_SHIM_DEBUG_MIGRATION_HH_
+#define SEXAIN_SHIM_DEBUG_MIGRATION_HH_
+
+#endif // SEXAIN_SHIM_DEBUG_MIGRATION_HH_
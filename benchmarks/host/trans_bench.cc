@@ -0,0 +1,125 @@
+// trans_bench.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+//
+// Translations per second of the address translation controller,
+// with MemStore callbacks dispatched virtually (as in gem5) or inlined.
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "addr_trans_controller_impl.h"
+#include "host_store.h"
+
+using namespace std;
+
+#define K (1024)
+#define M (1024 * K)
+
+template class BasicAddrTransController<MemStore>;
+template class BasicAddrTransController<DirectStore>;
+
+struct Config {
+  uint64_t phy_size;
+  uint64_t dram_size;
+  int att_len;
+  int block_bits;
+  int page_bits;
+  uint64_t num_ops;
+  double write_ratio;
+};
+
+struct Result {
+  double seconds;
+  uint64_t epochs;
+  uint64_t checksum;
+};
+
+template <class Store, class Interface>
+Result Run(const Config& c) {
+  const int block_size = 1 << c.block_bits;
+  Store store(0);
+  BasicAddrTransController<Interface> atc(c.phy_size, c.dram_size,
+      c.att_len, c.block_bits, c.page_bits, &store);
+  store.Resize(atc.Size());
+
+  Profiler base(c.block_bits, c.page_bits);
+  base.set_op_latency(1);
+
+  mt19937_64 rand(1);
+  uniform_int_distribution<uint64_t> blocks(0,
+      (c.phy_size >> c.block_bits) - 1);
+  bernoulli_distribution is_write(c.write_ratio);
+
+  vector<Addr> ckpt_blocks;
+  Result r = { 0, 0, 0 };
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  for (uint64_t i = 0; i < c.num_ops; ++i) {
+    const Addr phy_addr = blocks(rand) << c.block_bits;
+    Profiler pf(base);
+    if (is_write(rand)) {
+      if (atc.Probe(phy_addr) == NEW_EPOCH) {
+        atc.MigratePages(ckpt_blocks, pf);
+        atc.BeginCheckpointing(ckpt_blocks, pf);
+        atc.FinishCheckpointing();
+        ckpt_blocks.clear();
+        ++r.epochs;
+      }
+      r.checksum += atc.StoreAddr(phy_addr, block_size, pf);
+    } else {
+      r.checksum += atc.LoadAddr(phy_addr, pf);
+    }
+    r.checksum += pf.SumBusUtil();
+  }
+  chrono::duration<double> d = chrono::steady_clock::now() - begin;
+  r.seconds = d.count();
+  r.checksum += store.num_writes();
+  return r;
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 6) {
+    cout << "Usage: " << argv[0] << " [PHY MBs] [DRAM MBs] [ATT length]"
+        " [NUM of ops in Ms] [REPEATS]" << endl;
+    return -1;
+  }
+
+  Config c;
+  c.phy_size = (argc > 1 ? atol(argv[1]) : 64) * M;
+  c.dram_size = (argc > 2 ? atol(argv[2]) : 16) * M;
+  c.att_len = argc > 3 ? atoi(argv[3]) : 4096;
+  c.num_ops = (argc > 4 ? atol(argv[4]) : 4) * M;
+  c.block_bits = 6;
+  c.page_bits = 12;
+  c.write_ratio = 0.33;
+  const int reps = argc > 5 ? atoi(argv[5]) : 5;
+
+  // A warmup pass of each, then the minimum of interleaved repeats,
+  // as core_bench keeps, to filter out host noise
+  Result before = Run<VirtualStore, MemStore>(c);
+  Result after = Run<DirectStore, DirectStore>(c);
+  if (before.checksum != after.checksum || before.epochs != after.epochs) {
+    cerr << "Mismatched results of the two instantiations!" << endl;
+    return -1;
+  }
+  double before_secs = 0, after_secs = 0;
+  for (int r = 0; r < reps; ++r) {
+    before = Run<VirtualStore, MemStore>(c);
+    after = Run<DirectStore, DirectStore>(c);
+    before_secs = r ? min(before_secs, before.seconds) : before.seconds;
+    after_secs = r ? min(after_secs, after.seconds) : after.seconds;
+  }
+
+  cout << "ops=" << c.num_ops << ", epochs=" << before.epochs
+      << ", repeats=" << reps << ", PROFILE_LEVEL=" << PROFILE_LEVEL << endl;
+  cout << "virtual MemStore:\t" << c.num_ops / before_secs / M
+      << " M translations/s" << endl;
+  cout << "inlined store:\t\t" << c.num_ops / after_secs / M
+      << " M translations/s" << endl;
+  cout << "speedup:\t\t" << before_secs / after_secs << endl;
+  return 0;
+}
@@ -1,6 +1,6 @@
 #!/bin/bash
 
-GEM5ROOT=~/Projects/Sexain-CacheController/gem5-stable
+GEM5ROOT=~/Projects/Sexain-MemController/gem5-stable
 ARCH=X86 #X86_MESI_CMP_directory # in ./build_opts
 GEM5=$GEM5ROOT/build/$ARCH/gem5.opt
 SE_SCRIPT=$GEM5ROOT/configs/thnvm-se.py
@@ -10,11 +10,11 @@ NUM_CPUS=1
 CPU_CLOCK=3GHz
 
 MEM_TYPE=simple_mem # ddr3_1600_x64
+SCHEME=shadow
 MEM_SIZE=2GB # for whole physical address space
-DRAM_SIZE=2GB
+DRAM_SIZE=0GB # shadow pages take as much DRAM as the ATT
 ATT_LEN=6144
 BLOCK_BITS=6
-PTT_LEN=4128
 PAGE_BITS=12
 
 L1D_SIZE=32kB
@@ -31,7 +31,7 @@ L3_ASSOC=16
 RESV_WRITES=35000
 
 CPU2006ROOT=~/Share/spec-cpu-2006/benchspec/CPU2006
-OUT_DIR=~/Documents/gem5out-a$ATT_LEN-p$PTT_LEN-d$DRAM_SIZE
+OUT_DIR=~/Documents/gem5out-$SCHEME-a$ATT_LEN-d$DRAM_SIZE
 BUILD_NAME=build_base_none.0000
 
 to_run=0
@@ -82,11 +82,11 @@ OPTIONS+=" --cpu-type=$CPU_TYPE"
 OPTIONS+=" --num-cpus=$NUM_CPUS"
 OPTIONS+=" --cpu-clock=$CPU_CLOCK"
 OPTIONS+=" --mem-type=$MEM_TYPE"
+OPTIONS+=" --scheme=$SCHEME"
 OPTIONS+=" --mem-size=$MEM_SIZE"
 OPTIONS+=" --dram-size=$DRAM_SIZE"
 OPTIONS+=" --att-length=$ATT_LEN"
 OPTIONS+=" --block-bits=$BLOCK_BITS"
-OPTIONS+=" --ptt-length=$PTT_LEN"
 OPTIONS+=" --page-bits=$PAGE_BITS"
 OPTIONS+=" --l1d_size=$L1D_SIZE"
 OPTIONS+=" --l1d_assoc=$L1D_ASSOC"
@@ -0,0 +1,115 @@
+// crash_recovery.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#include "crash_recovery.h"
+
+#include <cstring>
+
+using namespace std;
+
+CrashRecovery::CrashRecovery(uint64_t phy_range, int block_bits,
+    int page_bits) :
+    phy_range_(phy_range), block_bits_(block_bits), page_bits_(page_bits),
+    image_(phy_range), committed_(phy_range),
+    written_(phy_range >> block_bits) {
+  assert(page_bits_ > block_bits_ && (phy_range_ & (page_size() - 1)) == 0);
+}
+
+void CrashRecovery::OnStore(Addr phy_addr, const uint8_t* data, int size) {
+  assert(phy_addr + size <= phy_range_);
+  const Addr block = phy_addr >> block_bits_;
+  assert(block == (phy_addr + size - 1) >> block_bits_);
+  memcpy(&image_[phy_addr], data, size);
+  if (!written_[block]) {
+    written_[block] = true;
+    written_blocks_.push_back(block);
+  }
+}
+
+void CrashRecovery::OnUntrackedStore(Addr phy_addr, const uint8_t* data,
+    int size) {
+  assert(phy_addr + size <= phy_range_);
+  memcpy(&image_[phy_addr], data, size);
+  memcpy(&committed_[phy_addr], data, size);
+}
+
+// The former home data is what checkpoints not mapping the block keep.
+static void MoveHome(MetaSnapshot& meta, Tag phy_tag, Addr mach_base) {
+  unordered_map<Tag, Addr>::iterator it = meta.blocks.find(phy_tag);
+  if (it == meta.blocks.end()) {
+    meta.blocks[phy_tag] = mach_base;
+  } else if (it->second == mach_base) {
+    meta.blocks.erase(it);
+  }
+}
+
+void CrashRecovery::OnCleanFreed(Tag phy_tag, Addr mach_base) {
+  MoveHome(persisted_, phy_tag, mach_base);
+  for (Checkpoint& ckpt : ckpts_) {
+    MoveHome(ckpt.meta, phy_tag, mach_base);
+  }
+}
+
+void CrashRecovery::OnCheckpointBegin(const MetaSnapshot& meta) {
+  ckpts_.push_back(Checkpoint());
+  Checkpoint& ckpt = ckpts_.back();
+  ckpt.meta = meta;
+  ckpt.blocks.swap(written_blocks_);
+  ckpt.data.resize(ckpt.blocks.size() << block_bits_);
+  for (vector<Addr>::size_type i = 0; i < ckpt.blocks.size(); ++i) {
+    const Addr block = ckpt.blocks[i];
+    memcpy(&ckpt.data[i << block_bits_], &image_[block << block_bits_],
+        block_size());
+    written_[block] = false;
+  }
+}
+
+void CrashRecovery::OnCheckpointFinish() {
+  assert(!ckpts_.empty());
+  const Checkpoint& ckpt = ckpts_.front();
+  for (vector<Addr>::size_type i = 0; i < ckpt.blocks.size(); ++i) {
+    memcpy(&committed_[ckpt.blocks[i] << block_bits_],
+        &ckpt.data[i << block_bits_], block_size());
+  }
+  persisted_ = ckpt.meta;
+  ckpts_.pop_front();
+}
+
+RecoveryStats CrashRecovery::Recover(const uint8_t* mem) const {
+  RecoveryStats stats = { };
+  const unordered_map<Tag, Addr>& remapped = persisted_.blocks;
+  unordered_map<Addr, const MetaSnapshot::Page*> cached;
+  for (const MetaSnapshot::Page& page : persisted_.pages) {
+    cached[page.phy_addr] = &page;
+  }
+
+  for (Addr page_addr = 0; page_addr < phy_range_; page_addr += page_size()) {
+    // NVM copy of a page cached in DRAM, as checkpointed
+    const uint8_t* copy = NULL;
+    unordered_map<Addr, const MetaSnapshot::Page*>::iterator ci =
+        cached.find(page_addr);
+    if (ci != cached.end()) {
+      copy = mem + (ci->second->state == PTTEntry::CLEAN_DIRECT ?
+          page_addr : ci->second->backup_base);
+      ++stats.pages;
+    }
+
+    for (Addr addr = page_addr; addr < page_addr + page_size();
+        addr += block_size()) {
+      const uint8_t* data;
+      unordered_map<Tag, Addr>::const_iterator ri;
+      if (copy) {
+        data = copy + (addr - page_addr);
+      } else if ((ri = remapped.find(Tag(addr >> block_bits_))) !=
+          remapped.end()) {
+        data = mem + ri->second;
+        ++stats.remapped_blocks;
+      } else {
+        data = mem + addr;
+      }
+      ++stats.blocks;
+      if (memcmp(data, &committed_[addr], block_size())) ++stats.mismatches;
+    }
+  }
+  return stats;
+}
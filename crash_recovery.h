@@ -0,0 +1,81 @@
+// crash_recovery.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_CRASH_RECOVERY_H_
+#define SEXAIN_CRASH_RECOVERY_H_
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include "migration_controller.h"
+
+/// Translation metadata persisted by a checkpoint
+struct MetaSnapshot {
+  struct Page {
+    Addr phy_addr;
+    PTTEntry::State state; ///< Clean state after the checkpoint
+    Addr backup_base; ///< Static copy in the backup region
+  };
+
+  std::unordered_map<Tag, Addr> blocks; ///< CLEAN ATT entries
+  std::vector<Page> pages;
+};
+
+struct RecoveryStats {
+  uint64_t blocks; ///< Blocks of the physical space verified
+  uint64_t mismatches; ///< Blocks that differ from the committed image
+  uint64_t remapped_blocks; ///< Blocks recovered from version buffer slots
+  uint64_t pages; ///< DRAM pages recovered from their NVM copies
+};
+
+/// Models power failures. It keeps the committed image as a shadow copy.
+/// Recovery rebuilds the image of the last finished checkpoint from the
+/// NVM home and backup regions, version buffer slots and persisted
+/// metadata, i.e., only from what the controller has written to NVM.
+class CrashRecovery {
+ public:
+  CrashRecovery(uint64_t phy_range, int block_bits, int page_bits);
+
+  /// Tracks the image written by accesses
+  void OnStore(Addr phy_addr, const uint8_t* data, int size);
+  /// Tracks writes that bypass the controller and are durable at once
+  void OnUntrackedStore(Addr phy_addr, const uint8_t* data, int size);
+  /// Remaps a block whose CLEAN version is moved into its home in
+  /// checkpointing, with the former home data moved to @mach_base
+  void OnCleanFreed(Tag phy_tag, Addr mach_base);
+  /// Takes the metadata and dirty data of an epoch to checkpoint
+  void OnCheckpointBegin(const MetaSnapshot& meta);
+  void OnCheckpointFinish();
+
+  /// Rebuilds the image of the last finished checkpoint from the memory
+  /// as it is at a power failure, and verifies it
+  /// @mem Host memory of the machine address space
+  RecoveryStats Recover(const uint8_t* mem) const;
+
+  const MetaSnapshot& persisted_meta() const { return persisted_; }
+  int block_size() const { return 1 << block_bits_; }
+  int page_size() const { return 1 << page_bits_; }
+
+ private:
+  struct Checkpoint {
+    MetaSnapshot meta;
+    std::vector<Addr> blocks; ///< Blocks written in the epoch
+    std::vector<uint8_t> data; ///< Their contents at the end of the epoch
+  };
+
+  const uint64_t phy_range_;
+  const int block_bits_;
+  const int page_bits_;
+
+  std::vector<uint8_t> image_; ///< As written by accesses
+  std::vector<uint8_t> committed_; ///< As of the last finished checkpoint
+  std::vector<bool> written_; ///< Per block, in the current epoch
+  std::vector<Addr> written_blocks_;
+
+  std::deque<Checkpoint> ckpts_; ///< In checkpointing, oldest first
+  MetaSnapshot persisted_;
+};
+
+#endif // SEXAIN_CRASH_RECOVERY_H_
@@ -0,0 +1,104 @@
+// epoch_trigger.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_EPOCH_TRIGGER_H_
+#define SEXAIN_EPOCH_TRIGGER_H_
+
+#include <cstdint>
+#include <cassert>
+
+/// Decides when to end an epoch ahead of a full ATT or PTT.
+/// The controller still forces a new epoch on a full table regardless.
+class EpochTrigger {
+ public:
+  EpochTrigger() : start_(0), writes_(0), last_access_(0) { }
+  virtual ~EpochTrigger() { }
+
+  void OnEpochStart(uint64_t now) { start_ = now; writes_ = 0; }
+  void OnAccess(uint64_t now, bool is_write);
+
+  /// @ckpt_time The estimated time to checkpoint the current epoch
+  virtual bool Fire(uint64_t now, uint64_t ckpt_time) = 0;
+  /// The idle time after which Fire() should be checked again,
+  /// or zero if accesses alone drive the trigger
+  virtual uint64_t idle_time() const { return 0; }
+
+  uint64_t epoch_start() const { return start_; }
+  uint64_t epoch_writes() const { return writes_; }
+
+ protected:
+  uint64_t start_; ///< Time the current epoch starts
+  uint64_t writes_; ///< Number of writes in the current epoch
+  uint64_t last_access_; ///< Time of the last access
+};
+
+/// Ends epochs only on a full ATT or PTT, i.e., by write footprint
+class FootprintTrigger : public EpochTrigger {
+ public:
+  bool Fire(uint64_t now, uint64_t ckpt_time) { return false; }
+};
+
+/// Ends an epoch after a fixed time interval
+class IntervalTrigger : public EpochTrigger {
+ public:
+  IntervalTrigger(uint64_t interval) : interval_(interval) {
+    assert(interval_);
+  }
+  bool Fire(uint64_t now, uint64_t ckpt_time) {
+    return now - start_ >= interval_;
+  }
+ private:
+  const uint64_t interval_;
+};
+
+/// Ends an epoch after a budget of writes
+class WriteBudgetTrigger : public EpochTrigger {
+ public:
+  WriteBudgetTrigger(uint64_t budget) : budget_(budget) { assert(budget_); }
+  bool Fire(uint64_t now, uint64_t ckpt_time) { return writes_ >= budget_; }
+ private:
+  const uint64_t budget_;
+};
+
+/// Ends an epoch once its checkpoint is amortized to the target overhead
+/// (checkpoint time over epoch time), or before the checkpoint grows
+/// beyond a bound that would stall accesses in one long burst.
+class AdaptiveTrigger : public EpochTrigger {
+ public:
+  AdaptiveTrigger(double overhead, uint64_t max_ckpt_time) :
+      overhead_(overhead), max_ckpt_time_(max_ckpt_time) {
+    assert(overhead_ > 0);
+  }
+  bool Fire(uint64_t now, uint64_t ckpt_time);
+ private:
+  const double overhead_;
+  const uint64_t max_ckpt_time_; ///< Zero for no bound
+};
+
+/// Ends an epoch early when memory stays idle, so that the checkpoint
+/// overlaps with the idle period instead of later accesses.
+class IdleTrigger : public EpochTrigger {
+ public:
+  IdleTrigger(uint64_t idle_time, uint64_t min_writes = 1) :
+      idle_time_(idle_time), min_writes_(min_writes) { assert(idle_time_); }
+  bool Fire(uint64_t now, uint64_t ckpt_time) {
+    return writes_ >= min_writes_ && now - last_access_ >= idle_time_;
+  }
+  uint64_t idle_time() const { return idle_time_; }
+ private:
+  const uint64_t idle_time_;
+  const uint64_t min_writes_;
+};
+
+inline void EpochTrigger::OnAccess(uint64_t now, bool is_write) {
+  last_access_ = now;
+  if (is_write) ++writes_;
+}
+
+inline bool AdaptiveTrigger::Fire(uint64_t now, uint64_t ckpt_time) {
+  if (!writes_) return false;
+  if (max_ckpt_time_ && ckpt_time >= max_ckpt_time_) return true;
+  return ckpt_time <= overhead_ * (now - start_);
+}
+
+#endif // SEXAIN_EPOCH_TRIGGER_H_
@@ -94,13 +94,20 @@ def config_cache(options, system):
         system.l2.cpu_side = system.tol2bus.master
         system.l2.mem_side = system.membus.slave
 
+    # Private caches of a level share one controller, and thus the budget
+    # of dirty blocks, across all CPUs.
+    if options.caches:
+        dcc = CacheController(memory=system.mem_ctrls[0],
+                block_bits=options.block_bits, att_length=options.att_length)
+        if options.l3cache:
+            l2cc = CacheController(memory=system.mem_ctrls[0],
+                    block_bits=options.block_bits,
+                    att_length=options.att_length)
+
     for i in xrange(options.num_cpus):
         if options.caches:
             icache = icache_class(size=options.l1i_size,
                                   assoc=options.l1i_assoc)
-            dcc = CacheController(memory=system.mem_ctrls[0],
-                    block_bits=options.block_bits,
-                    att_length=options.att_length)
             dcache = dcache_class(size=options.l1d_size,
                                   assoc=options.l1d_assoc,
                                   controller=dcc,
@@ -114,9 +121,6 @@ def config_cache(options, system):
             # When connecting the caches, the clock is also inherited
             # from the CPU in question
             if options.l3cache:
-                l2cc = CacheController(memory=system.mem_ctrls[0],
-                        block_bits=options.block_bits,
-                        att_length=options.att_length)
                 l2c = l2_cache_class(clk_domain=system.cpu_clk_domain,
                                      size=options.l2_size,
                                      assoc=options.l2_assoc,
@@ -157,10 +157,15 @@ def config_mem(options, system):
             # Create an instance so we can figure out the address
             # mapping and row-buffer size
             if issubclass(cls, m5.objects.AbstractMemory):
-                ctrl = cls(att_length=options.att_length,
+                ctrl = cls(scheme=options.scheme,
+                        att_length=options.att_length,
                         block_bits=options.block_bits,
                         page_bits=options.page_bits,
                         dram_size=options.dram_size,
+                        huge_pages=options.huge_pages,
+                        numa_policy=options.numa_policy,
+                        numa_nodes=[int(n) for n in
+                                    options.numa_nodes.split(',') if n],
                         disable_timing=options.disable_timing)
             else:
                 ctrl = cls()
@@ -118,6 +118,9 @@ parser = optparse.OptionParser()
 Options.addCommonOptions(parser)
 Options.addSEOptions(parser)
 
+parser.add_option("--scheme", type="choice", default="thnvm",
+        choices=["thnvm", "journal", "shadow"],
+        help="Persistence scheme, THNVM or a baseline to compare with")
 parser.add_option("--dram-size", type="string", default="0B",
         help="Size of DRAM")
 parser.add_option("--att-length", type="int", default=0,
@@ -128,6 +131,14 @@ parser.add_option("--page-bits", type="int", default=12,
         help="Number of bits of page in the secondary page table")
 parser.add_option("--reserved-writes", type="int",
         help="Number of reserved writeback buffers in caches")
+parser.add_option("--huge-pages", type="choice", default="none",
+        choices=["none", "thp", "hugetlb"],
+        help="Huge pages of the host backing store")
+parser.add_option("--numa-policy", type="choice", default="local",
+        choices=["local", "bind", "interleave"],
+        help="Host NUMA policy of the backing store")
+parser.add_option("--numa-nodes", type="string", default="",
+        help="Comma-separated host NUMA nodes for --numa-policy")
 
 parser.add_option("--disable-timing", action="store_true", default=False,
         help="Whether to avoid timing THNVM")
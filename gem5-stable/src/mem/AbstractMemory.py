@@ -43,16 +43,54 @@
 from m5.params import *
 from MemObject import MemObject
 
+# Enum for the persistence scheme: THNVM, or a baseline of redo logging
+# or page-level shadow paging
+class PersistScheme(Enum): vals = ['thnvm', 'journal', 'shadow']
+
+# Enum for huge pages of the backing store: none, transparent huge pages
+# advised by madvise, or pages reserved in the hugetlb pool
+class HugePagePolicy(Enum): vals = ['none', 'thp', 'hugetlb']
+
+# Enum for the host NUMA policy of the backing store
+class NumaPolicy(Enum): vals = ['local', 'bind', 'interleave']
+
 class AbstractMemory(MemObject):
     type = 'AbstractMemory'
     abstract = True
     cxx_header = "mem/abstract_mem.hh"
     range = Param.AddrRange("Physical address range")
+    scheme = Param.PersistScheme('thnvm', "Persistence scheme")
     att_length = Param.Int(0, "Addr Translation Table length")
     block_bits = Param.Int(6, "Number of bits of cache block size")
     page_bits = Param.Int(12, "Number of bits of page size in 2nd page table")
     dram_size = Param.Addr("DRAM size")
+    version_depth = Param.Int(2, "Number of NVM backup versions, "
+            "i.e., at most one fewer epochs in checkpointing at a time")
+    stream_blocks = Param.Int(0, "Sequential or strided block writes "
+            "that promote a NVM page to DRAM at the end of the epoch, "
+            "and the next page of the stream at once (0 to disable)")
+    elide_zero_blocks = Param.Bool(True,
+            "Map dirty versions of all zeros to a shared zero block")
+    wear_tracking = Param.Bool(False,
+            "Count writes per NVM line for wear statistics")
+    start_gap_interval = Param.Unsigned(100,
+            "NVM home writes per Start-Gap move (0 to disable)")
+    log_length = Param.Unsigned(0, "Journal log blocks in NVM "
+            "(0 for the whole version buffer region)")
+    log_batch = Param.Unsigned(8,
+            "Journal data blocks logged per descriptor block")
+    crash_recovery = Param.Bool(False,
+            "Track the committed image to verify recovery at power failures")
     null = Param.Bool(False, "Do not store data, always return zero")
+    sparse_backing = Param.Bool(False, "Reserve the backing store without "
+            "swap space (MAP_NORESERVE), committing host memory only for "
+            "touched pages, e.g., to simulate NVM of hundreds of GB")
+    huge_pages = Param.HugePagePolicy('none', "Huge pages of the backing "
+            "store, to cut host TLB misses on random accesses")
+    numa_policy = Param.NumaPolicy('local',
+            "Host NUMA policy of the backing store")
+    numa_nodes = VectorParam.Unsigned([],
+            "Host NUMA nodes to bind or interleave the backing store on")
 
     # All memories are passed to the global physical memory, and
     # certain memories may be excluded from the global address map,
@@ -42,6 +42,14 @@
 from m5.params import *
 from AbstractMemory import *
 
+# Enum for the policy to end epochs besides a full ATT or PTT
+class EpochPolicy(Enum): vals = ['footprint', 'interval', 'writes',
+                                 'adaptive', 'idle']
+
+# Enum for how NVM block writes program cells: all bits, changed bits
+# only (data-comparison write), or changed bits with Flip-N-Write
+class NVMWriteMode(Enum): vals = ['full', 'dcw', 'fnw']
+
 class SimpleMemory(AbstractMemory):
     type = 'SimpleMemory'
     cxx_header = "mem/simple_mem.hh"
@@ -56,7 +64,34 @@ class SimpleMemory(AbstractMemory):
     lat_att_operate = Param.Latency('3ns', "ATT operation latency")
     lat_buffer_operate = Param.Latency('3ns',
             "Version buffer operation latency")
+    att_cache_entries = Param.Unsigned(0, "ATT entries cached in the "
+            "controller, with the table in DRAM (0 to keep it in SRAM)")
+    ptt_cache_entries = Param.Unsigned(0, "PTT entries cached in the "
+            "controller, with the table in DRAM (0 to keep it in SRAM)")
+    trans_cache_assoc = Param.Unsigned(8,
+            "Associativity of the ATT and PTT caches")
+    lat_trans_cache = Param.Latency('1ns',
+            "ATT and PTT cache lookup latency")
     lat_nvm_read = Param.Latency('128ns', "NVM read latency")
     lat_nvm_write = Param.Latency('368ns', "NVM write latency")
+    nvm_write_mode = Param.NVMWriteMode('full',
+            "How NVM block writes program cells")
+    nvm_write_unit = Param.Unsigned(64,
+            "Bits programmed in parallel per NVM write round")
+    wcb_entries = Param.Unsigned(0,
+            "Blocks in the NVM write-combining buffer (0 to disable)")
+    lat_wcb = Param.Latency('3ns', "Write-combining buffer access latency")
     disable_timing = Param.Bool(True, "If THNVM is not timed")
+    epoch_trigger = Param.EpochPolicy('footprint',
+            "Policy to end epochs besides a full ATT or PTT")
+    epoch_interval = Param.Latency('1ms', "Epoch length (interval)")
+    epoch_writes = Param.UInt64(65536, "Writes per epoch (writes)")
+    epoch_overhead = Param.Float(0.05,
+            "Target checkpoint time over epoch time (adaptive)")
+    epoch_max_ckpt = Param.Latency('50us',
+            "Estimated checkpoint time that forces an epoch end (adaptive)")
+    epoch_idle = Param.Latency('5us',
+            "Idle time that ends an epoch early (idle)")
+    crash_time = Param.Latency('0ns', "Time of a simulated power failure, "
+            "which recovers and exits (0 to disable, needs crash_recovery)")
 
@@ -44,8 +44,16 @@
  */
 
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
 #include "arch/registers.hh"
 #include "config/the_isa.hh"
+#include "cpu/base.hh"
 #include "debug/LLSC.hh"
 #include "debug/MemoryAccess.hh"
 #include "mem/abstract_mem.hh"
@@ -58,29 +66,136 @@ using namespace std;
 AbstractMemory::AbstractMemory(const Params *p) :
     MemObject(p), range(params()->range),
     profBase(p->block_bits, p->page_bits),
-    addrController(range.size(), p->dram_size,
-            p->att_length, p->block_bits, p->page_bits, this),
+    profNull(p->block_bits, p->page_bits),
+    addrController(*createController(p, range.size(), this)),
     pmemAddr(NULL), confTableReported(p->conf_table_reported),
+    elideZeroBlocks(p->elide_zero_blocks), startGap(NULL),
+    crashRecovery(NULL),
     inAddrMap(p->in_addr_map), _system(NULL)
 {
     if (range.size() % TheISA::PageBytes != 0)
         panic("Memory Size not divisible by page size\n");
+    if (p->wear_tracking) {
+        uint64_t home_lines = range.size() >> p->block_bits;
+        lineWrites.resize(home_lines + 1 +
+                addrController.nvm_buffer().length() +
+                (addrController.migrator().backup_size() >> p->block_bits));
+        if (p->start_gap_interval)
+            startGap = new StartGap(home_lines, p->start_gap_interval);
+    }
+    addrController.set_stream_blocks(p->stream_blocks);
+    if (p->crash_recovery && p->scheme != Enums::thnvm)
+        fatal("%s: crash_recovery needs the thnvm scheme\n", name());
+    if (p->crash_recovery) {
+        crashRecovery = new CrashRecovery(range.size(), p->block_bits,
+                p->page_bits);
+        addrController.set_meta_snapshot(true);
+    }
+    storeData = NULL;
     ckBusUtil = 0;
     ckDRAMWriteHits = 0;
     regCaches = 0;
+    attFree = addrController.att_free_length();
+    attDirty = addrController.att_dirty_length();
+    residentBytesFunc.memory = this;
+    hugeBytesFunc.memory = this;
 #ifdef MEMCK
     ckmem = (uint8_t*) mmap(NULL, hostSize(), PROT_READ | PROT_WRITE,
-            MAP_ANON | MAP_PRIVATE, -1, 0);
+            MAP_ANON | MAP_PRIVATE | (isSparse() ? MAP_NORESERVE : 0), -1, 0);
     inform("THNVM runs with memory check.\n");
 #endif
 }
 
+AddrTransController*
+AbstractMemory::createController(const Params* p, uint64_t size,
+                                 MemStore* store)
+{
+    switch (p->scheme) {
+      case Enums::journal:
+        return new JournalController(size, p->dram_size, p->att_length,
+                p->block_bits, p->page_bits, store, p->version_depth,
+                p->log_length, p->log_batch);
+      case Enums::shadow:
+        return new ShadowController(size, p->dram_size, p->att_length,
+                p->block_bits, p->page_bits, store, p->version_depth);
+      default:
+        return new AddrTransController(size, p->dram_size, p->att_length,
+                p->block_bits, p->page_bits, store, p->version_depth);
+    }
+}
+
 void
 AbstractMemory::setBackingStore(uint8_t* pmem_addr)
 {
     pmemAddr = pmem_addr;
 }
 
+uint64_t
+AbstractMemory::residentBytes() const
+{
+    if (!pmemAddr)
+        return 0;
+    // In chunks, so that the vector stays small for huge stores
+    const uint64_t host_page = sysconf(_SC_PAGESIZE);
+    const uint64_t chunk = host_page << 16;
+    vector<unsigned char> vec(chunk / host_page);
+    uint64_t pages = 0;
+    for (uint64_t offset = 0; offset < hostSize(); offset += chunk) {
+        uint64_t len = min(chunk, hostSize() - offset);
+        if (mincore(pmemAddr + offset, len, &vec[0]) != 0) {
+            warn("%s: mincore failed on the backing store\n", name());
+            return 0;
+        }
+        for (uint64_t i = 0; i < divCeil(len, host_page); ++i)
+            pages += vec[i] & 1;
+    }
+    return pages * host_page;
+}
+
+uint64_t
+AbstractMemory::hugeBytes() const
+{
+    if (!pmemAddr)
+        return 0;
+    // Summed over the mappings of the store, which madvise and mbind
+    // may split
+    ifstream smaps("/proc/self/smaps");
+    const uintptr_t begin = (uintptr_t)pmemAddr;
+    const uintptr_t end = begin + hostSize();
+    bool in_store = false;
+    uint64_t kb = 0;
+    string line;
+    while (getline(smaps, line)) {
+        unsigned long start, stop, size;
+        char key[32];
+        if (sscanf(line.c_str(), "%lx-%lx ", &start, &stop) == 2) {
+            in_store = start < end && stop > begin;
+        } else if (in_store &&
+                   sscanf(line.c_str(), "%31s %lu kB", key, &size) == 2 &&
+                   (!strcmp(key, "AnonHugePages:") ||
+                    !strcmp(key, "Private_Hugetlb:"))) {
+            kb += size;
+        }
+    }
+    return kb << 10;
+}
+
+Counter
+AbstractMemory::minorFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+Counter
+AbstractMemory::majorFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_majflt;
+}
+
 void
 AbstractMemory::regStats()
 {
@@ -187,6 +302,35 @@ AbstractMemory::regStats()
     numEpochs
         .name(name() + ".num_epochs")
         .desc("Total number of epochs");
+    numInsts
+        .functor(BaseCPU::numSimulatedInsts)
+        .name(name() + ".num_insts")
+        .desc("Number of instructions simulated, for epoch rates")
+        .precision(0);
+    hostResidentBytes
+        .functor(residentBytesFunc)
+        .name(name() + ".host_resident_bytes")
+        .desc("Bytes of the backing store resident in host memory")
+        .precision(0);
+    hostHugeBytes
+        .functor(hugeBytesFunc)
+        .name(name() + ".host_huge_bytes")
+        .desc("Bytes of the backing store in host huge pages")
+        .precision(0);
+    hostMinorFaults
+        .functor(minorFaults)
+        .name(name() + ".host_minor_faults")
+        .desc("Host page faults of the simulator without I/O")
+        .precision(0);
+    hostMajorFaults
+        .functor(majorFaults)
+        .name(name() + ".host_major_faults")
+        .desc("Host page faults of the simulator with I/O")
+        .precision(0);
+    epochsPerGInsts
+        .name(name() + ".epochs_per_ginsts")
+        .desc("Number of epochs per billion instructions")
+        .prereq(numEpochs);
     numATTWriteHits
         .name(name() + ".att_write_hits")
         .desc("Total number of write hits on ATT");
@@ -241,6 +385,28 @@ AbstractMemory::regStats()
         .desc("Number of pages migrated to NVM per epoch")
         .prereq(numPagesToNVM);
 
+    numPagesStreamed
+        .name(name() + ".num_pages_streamed")
+        .desc("Total number of pages promoted to DRAM on write streams");
+
+    numZeroBlocks
+        .name(name() + ".num_zero_blocks")
+        .desc("Total number of versions elided as zero blocks");
+
+    numGapMoves
+        .name(name() + ".num_gap_moves")
+        .desc("Number of Start-Gap moves in the NVM home region");
+    maxLineWrites
+        .name(name() + ".max_line_writes")
+        .desc("Writes to the most written NVM line");
+    totalLineWrites
+        .name(name() + ".total_line_writes")
+        .desc("Total writes to NVM lines");
+    avgLineWrites
+        .name(name() + ".avg_line_writes")
+        .desc("Average writes per NVM line")
+        .prereq(totalLineWrites);
+
     numRegCaches
         .name(name() + ".num_reg_caches")
         .desc("Number of caches registered to the THNVM cache controller");
@@ -255,8 +421,11 @@ AbstractMemory::regStats()
         constant(addrController.migrator().page_blocks());
     avgDRAMWriteRatio = numDRAMWrites / numDirtyDRAMPages /
         constant(addrController.migrator().page_blocks());
+    epochsPerGInsts = numEpochs * constant(1e9) / numInsts;
     avgPagesToDRAM = numPagesToDRAM / numEpochs;
     avgPagesToNVM = numPagesToNVM / numEpochs;
+    avgLineWrites = totalLineWrites /
+        constant(lineWrites.empty() ? 1 : lineWrites.size());
 }
 
 AddrRange
@@ -412,7 +581,7 @@ AbstractMemory::checkLockedAddrList(PacketPtr pkt)
 
 #define MEMCK_AFTER_WRITE(LA, PKT)                                             \
     do {                                                                       \
-        Addr post_addr = addrController.LoadAddr(localAddr(PKT), Profiler::Null);\
+        Addr post_addr = addrController.LoadAddr(localAddr(PKT), profNull);\
     	if (post_addr != (LA)) {                                               \
     	    warn("File %s, line %d: Memory write meets corrupted address: "    \
     	         "%lx => %lx for physical %lx\n",                              \
@@ -474,9 +643,15 @@ AbstractMemory::access(PacketPtr pkt, Profiler& pf)
         }
 
         if (overwrite_mem) {
-            Addr local_addr = addrController.LoadAddr(localAddr(pkt), pf);
+            Addr local_addr = addrController.UntrackedAddr(localAddr(pkt));
             memcpy(hostAddr(local_addr), &overwrite_val, pkt->getSize());
+            addrController.UntrackedStore(localAddr(pkt), local_addr,
+                    pkt->getSize());
             MEMCK_AFTER_WRITE(local_addr, pkt);
+            // out of versioning, taken as durable at once
+            if (crashRecovery)
+                crashRecovery->OnUntrackedStore(localAddr(pkt),
+                        (uint8_t*)&overwrite_val, pkt->getSize());
         }
 
         assert(!pkt->req->isInstFetch());
@@ -503,11 +678,17 @@ AbstractMemory::access(PacketPtr pkt, Profiler& pf)
         if (writeOK(pkt)) {
             if (pmemAddr) {
                 assert(pkt->getSize() == addrController.block_size());
+                storeData = pkt->getPtr<uint8_t>();
                 Addr local_addr = addrController.StoreAddr(
                         localAddr(pkt), pkt->getSize(), pf);
+                storeData = NULL;
+                publishATT();
                 memcpy(hostAddr(local_addr), pkt->getPtr<uint8_t>(),
                         pkt->getSize());
                 MEMCK_AFTER_WRITE(local_addr, pkt);
+                if (crashRecovery)
+                    crashRecovery->OnStore(localAddr(pkt),
+                            pkt->getPtr<uint8_t>(), pkt->getSize());
                 pf.AddBlockMoveInter();
                 DPRINTF(MemoryAccess, "%s wrote %x bytes to address %x\n",
                         __func__, pkt->getSize(), pkt->getAddr());
@@ -533,7 +714,9 @@ AbstractMemory::functionalAccess(PacketPtr pkt)
 {
     assert(AddrRange(pkt->getAddr(),
                      pkt->getAddr() + pkt->getSize() - 1).isSubset(range));
-    Addr local_addr = addrController.LoadAddr(localAddr(pkt), Profiler::Null);
+    Addr local_addr = pkt->isWrite() ?
+            addrController.UntrackedAddr(localAddr(pkt)) :
+            addrController.LoadAddr(localAddr(pkt), profNull);
     uint8_t *host_addr = hostAddr(local_addr);
 
     if (pkt->isRead()) {
@@ -546,7 +729,12 @@ AbstractMemory::functionalAccess(PacketPtr pkt)
     } else if (pkt->isWrite()) {
         if (pmemAddr) {
             memcpy(host_addr, pkt->getPtr<uint8_t>(), pkt->getSize());
+            addrController.UntrackedStore(localAddr(pkt), local_addr,
+                    pkt->getSize());
             MEMCK_AFTER_WRITE(local_addr, pkt);
+            if (crashRecovery)
+                crashRecovery->OnUntrackedStore(localAddr(pkt),
+                        pkt->getPtr<uint8_t>(), pkt->getSize());
         }
         TRACE_PACKET("Write");
         pkt->makeResponse();
@@ -570,6 +758,7 @@ AbstractMemory::MemCopy(uint64_t direct_addr, uint64_t mach_addr, int size)
 {
     assert(direct_addr != mach_addr);
     memcpy(hostAddr(direct_addr), hostAddr(mach_addr), size);
+    recordNVMWrites(direct_addr, size);
 }
 
 void
@@ -580,5 +769,79 @@ AbstractMemory::MemSwap(uint64_t direct_addr, uint64_t mach_addr, int size)
     memcpy(data, hostAddr(direct_addr), size);
     memcpy(hostAddr(direct_addr), hostAddr(mach_addr), size);
     memcpy(hostAddr(mach_addr), data, size);
+    recordNVMWrites(direct_addr, size);
+    recordNVMWrites(mach_addr, size);
+}
+
+bool
+AbstractMemory::IsZero(uint64_t mach_addr, int size)
+{
+    if (!elideZeroBlocks || !pmemAddr)
+        return false;
+    const uint8_t* data = hostAddr(mach_addr);
+    return data[0] == 0 && !memcmp(data, data + 1, size - 1);
+}
+
+void
+AbstractMemory::recordNVMWrite(Addr mach_addr)
+{
+    if (lineWrites.empty())
+        return;
+    const uint64_t line = mach_addr / addrController.block_size();
+    if (mach_addr < addrController.phy_range()) {
+        countLineWrite(startGap ? startGap->Map(line) : line);
+        uint64_t moved;
+        if (startGap && startGap->OnWrite(&moved)) {
+            ++numGapMoves;
+            countLineWrite(moved);
+        }
+    } else if (addrController.nvm_buffer().Contains(mach_addr)) {
+        countLineWrite(line + 1); // slots follow the gap line
+    } else if (mach_addr >= addrController.backup_base() &&
+               mach_addr < addrController.cache_base()) {
+        // the backup region follows the slots
+        countLineWrite(lineWrites.size() - (addrController.cache_base() -
+                mach_addr) / addrController.block_size());
+    }
 }
 
+void
+AbstractMemory::recordNVMWrites(Addr mach_addr, int size)
+{
+    if (lineWrites.empty())
+        return;
+    const int block_size = addrController.block_size();
+    for (Addr a = mach_addr; a < mach_addr + size; a += block_size) {
+        recordNVMWrite(a);
+    }
+}
+
+void
+AbstractMemory::countLineWrite(uint64_t index)
+{
+    uint32_t writes = ++lineWrites[index];
+    ++totalLineWrites;
+    if (writes > maxLineWrites.value())
+        maxLineWrites = writes;
+}
+
+void
+AbstractMemory::publishATT()
+{
+    int free = addrController.att_free_length();
+    int dirty = addrController.att_dirty_length();
+    if (free == attFree && dirty == attDirty)
+        return;
+    attFree = free;
+    attDirty = dirty;
+    for (int i = 0; i < attObservers.size(); ++i)
+        attObservers[i]->OnATTUpdate(attFree, attDirty);
+}
+
+void
+AbstractMemory::publishEpoch()
+{
+    for (int i = 0; i < attObservers.size(); ++i)
+        attObservers[i]->OnEpochBegin();
+    publishATT();
+}
@@ -55,6 +55,10 @@
 #include "sim/stats.hh"
 
 #include "mem/addr_trans_controller.h"
+#include "mem/journal_controller.h"
+#include "mem/shadow_controller.h"
+#include "mem/start_gap.h"
+#include "mem/crash_recovery.h"
 
 class System;
 
@@ -111,8 +115,11 @@ class AbstractMemory : public MemObject, public MemStore
     // Base profiler for copy construction
     Profiler profBase;
 
-    // Controller for addr translation
-    AddrTransController addrController;
+    // Sink profiler for untimed accesses
+    Profiler profNull;
+
+    // Controller for addr translation of the persistence scheme
+    AddrTransController& addrController;
 
     // Pointer to host memory used to implement this memory
     uint8_t* pmemAddr;
@@ -120,6 +127,25 @@ class AbstractMemory : public MemObject, public MemStore
     // Enable specific memories to be reported to the configuration table
     bool confTableReported;
 
+    // Let versions of all zeros share a block instead of buffer slots
+    bool elideZeroBlocks;
+
+    // Wear leveling of the NVM home region
+    StartGap* startGap;
+
+    // Committed image for power failure simulation, or NULL if not enabled
+    CrashRecovery* crashRecovery;
+
+    // Writes per NVM line, for home lines (plus the gap), buffer slots,
+    // then the backup region. Empty if wear is not tracked.
+    std::vector<uint32_t> lineWrites;
+
+    // Count a write to an NVM line, ignoring DRAM addresses
+    void recordNVMWrite(Addr mach_addr);
+    // Count a write to every line of a range, e.g., a page copy
+    void recordNVMWrites(Addr mach_addr, int size);
+    void countLineWrite(uint64_t index);
+
     // Should the memory appear in the global address map
     bool inAddrMap;
 
@@ -192,6 +218,28 @@ class AbstractMemory : public MemObject, public MemStore
 
     /** Number of epochs */
     Stats::Scalar numEpochs;
+    /** Instructions simulated by all CPUs */
+    Stats::Value numInsts;
+
+    /** Functor of the host memory resident in the backing store */
+    struct ResidentBytes {
+        const AbstractMemory* memory;
+        Counter operator()() const { return memory->residentBytes(); }
+    } residentBytesFunc;
+    /** Bytes of the backing store committed in host memory */
+    Stats::Value hostResidentBytes;
+    /** Functor of the host memory in huge pages of the backing store */
+    struct HugeBytes {
+        const AbstractMemory* memory;
+        Counter operator()() const { return memory->hugeBytes(); }
+    } hugeBytesFunc;
+    /** Bytes of the backing store in host huge pages */
+    Stats::Value hostHugeBytes;
+    /** Host page faults of the simulator, the cost of touching the store */
+    Stats::Value hostMinorFaults;
+    Stats::Value hostMajorFaults;
+    /** Epochs per billion instructions */
+    Stats::Formula epochsPerGInsts;
     /** Number of write hits on ATT */
     Stats::Scalar numATTWriteHits;
     /** Number of write misses on ATT */
@@ -227,15 +275,51 @@ class AbstractMemory : public MemObject, public MemStore
     /** Average number of pages migrated to NVM per epoch */
     Stats::Formula avgPagesToNVM;
 
+    /** Total number of pages promoted to DRAM on write streams */
+    Stats::Scalar numPagesStreamed;
+
+    /** Total number of versions elided as zero blocks */
+    Stats::Scalar numZeroBlocks;
+
+    /** Number of Start-Gap moves in the NVM home region */
+    Stats::Scalar numGapMoves;
+    /** Writes to the most written NVM line */
+    Stats::Scalar maxLineWrites;
+    /** Total writes to NVM lines */
+    Stats::Scalar totalLineWrites;
+    /** Average writes per NVM line */
+    Stats::Formula avgLineWrites;
+
     int regCaches;
     Stats::Formula numRegCaches;
 
+    /** Cache controllers that the ATT occupancy is published to */
+    std::vector<ATTObserver*> attObservers;
+    /** ATT occupancy as last published */
+    int attFree;
+    int attDirty;
+
+    /**
+     * Publish the ATT occupancy to the observers if it has changed.
+     */
+    void publishATT();
+
+    /**
+     * Tell the observers that a new epoch begins, and publish the ATT
+     * occupancy that checkpointing leaves.
+     */
+    void publishEpoch();
+
     /** Pointor to the System object.
      * This is used for getting the number of masters in the system which is
      * needed when registering stats
      */
     System *_system;
 
+    // Data of the store in translation, which the timing model may
+    // compare with the old contents of the target block
+    const uint8_t* storeData;
+
     uint64_t ckBusUtil;
     uint64_t ckDRAMWriteHits; ///< Number of writes on DRAM without hitting ATT
 
@@ -256,7 +340,20 @@ class AbstractMemory : public MemObject, public MemStore
     typedef AbstractMemoryParams Params;
 
     AbstractMemory(const Params* p);
-    virtual ~AbstractMemory() {}
+    virtual ~AbstractMemory()
+    {
+        delete &addrController;
+        delete startGap;
+        delete crashRecovery;
+    }
+
+    /**
+     * Create the address translation controller of the persistence
+     * scheme, e.g., THNVM or a baseline to compare with.
+     */
+    static AddrTransController* createController(const Params* p,
+                                                 uint64_t size,
+                                                 MemStore* store);
 
     /**
      * See if this is a null memory that should never store data and
@@ -266,6 +363,33 @@ class AbstractMemory : public MemObject, public MemStore
      */
     bool isNull() const { return params()->null; }
 
+    /**
+     * See if the backing store only commits host memory for touched
+     * pages, so that untouched regions, e.g., version buffers, read as
+     * zeros without allocation.
+     *
+     * @return true if sparse
+     */
+    bool isSparse() const { return params()->sparse_backing; }
+
+    /**
+     * Get the bytes of the backing store resident in host memory.
+     */
+    uint64_t residentBytes() const;
+
+    /**
+     * Get the bytes of the backing store in host huge pages, either
+     * transparent or from the hugetlb pool.
+     */
+    uint64_t hugeBytes() const;
+
+    /**
+     * Get the page faults of the simulator process that needed no I/O,
+     * or that did, e.g., swapping the backing store in.
+     */
+    static Counter minorFaults();
+    static Counter majorFaults();
+
     /**
      * Set the host memory backing store to be used by this memory
      * controller.
@@ -355,7 +479,9 @@ class AbstractMemory : public MemObject, public MemStore
      * @param pkt Packet performing the access
      * @param pf Profiler counting internal behaviors
      */
-    void access(PacketPtr pkt, Profiler& pf = Profiler::Null);
+    void access(PacketPtr pkt, Profiler& pf);
+
+    void access(PacketPtr pkt) { access(pkt, profNull); }
 
     /**
      * Perform an untimed memory read or write without changing
@@ -374,17 +500,35 @@ class AbstractMemory : public MemObject, public MemStore
 
     virtual bool isDRAM(Addr phy_addr)
     {
-        return addrController.IsDRAM(phy_addr, Profiler::Null);
+        return addrController.IsDRAM(phy_addr, profNull);
+    }
+
+    /**
+     * Hint for cache replacement of whether writing back a block needs
+     * no new ATT entry.
+     */
+    bool absorbsWrite(Addr addr)
+    {
+        return range.contains(addr) &&
+                addrController.AbsorbsWrite(addr - range.start());
     }
 
     virtual void MemCopy(uint64_t direct_addr, uint64_t mach_addr, int size);
     virtual void MemSwap(uint64_t direct_addr, uint64_t mach_addr, int size);
+    virtual bool IsZero(uint64_t mach_addr, int size);
 
     virtual void OnWaiting()
     {
         panic("AbstractMemory should never have write waiting\n");
     }
 
+    virtual void OnCleanFreed(uint64_t phy_addr, uint64_t mach_base)
+    {
+        if (crashRecovery)
+            crashRecovery->OnCleanFreed(
+                    phy_addr / addrController.block_size(), mach_base);
+    }
+
     virtual void OnEpochEnd()
     {
         ++numEpochs;
@@ -405,6 +549,12 @@ class AbstractMemory : public MemObject, public MemStore
         ++regCaches;
     }
 
+    virtual void AddATTObserver(ATTObserver* observer)
+    {
+        attObservers.push_back(observer);
+        observer->OnATTUpdate(attFree, attDirty);
+    }
+
     virtual void statsNVMWrites(int n)
     {
         numNVMWrites += n;
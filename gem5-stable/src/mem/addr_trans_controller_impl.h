@@ -0,0 +1 @@
+../../../addr_trans_controller_impl.h
\ No newline at end of file
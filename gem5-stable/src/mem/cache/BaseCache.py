@@ -52,6 +52,18 @@ class CacheController(SimObject):
     block_bits = Param.Int(6, "number of bits of ATT block size")    
     att_length = Param.Int(0, "number of entries in ATT")    
     memory = Param.AbstractMemory(NULL, "system single memory")
+    flush_blocks = Param.Unsigned(16, "number of tracked blocks written "
+            "back per flush step (0 to flush them at once)")
+    flush_interval = Param.Latency('10ns', "time between flush steps")
+    clean_high = Param.Float(0, "fraction of att_length of tracked blocks "
+            "that starts writing back the least recently written ones "
+            "(0 to disable)")
+    clean_low = Param.Float(0.5,
+            "fraction of att_length of tracked blocks that stops it")
+    clean_interval = Param.Latency('10ns',
+            "time between such writebacks, which wait for an idle bus")
+    epoch_flush = Param.Bool(False, "flush the tracked blocks as each "
+            "epoch of the memory begins")
 
 class BaseCache(MemObject):
     type = 'BaseCache'
@@ -284,6 +284,12 @@ class BaseCache : public MemObject
      * Write back dirty blocks in the cache using timing accesses.
      */
     virtual void writebackAllTiming() { ++cacheFlushes; }
+    /**
+     * Write back a block by its address using a timing access.
+     *
+     * \return true if the block is found dirty and written back.
+     */
+    virtual bool writebackTiming(Addr addr) = 0;
     /**
      * Invalidates all blocks in the cache.
      *
@@ -512,6 +518,14 @@ class BaseCache : public MemObject
         return blocked != 0;
     }
 
+    /**
+     * Returns true if no misses or writebacks wait for the memory side.
+     */
+    bool isMemSideIdle() const
+    {
+        return !mshrQueue.havePending() && !writeBuffer.havePending();
+    }
+
     /**
      * Marks the access path of the cache as blocked for the given cause. This
      * also sets the blocked flag in the slave interface.
@@ -415,6 +415,7 @@ class Cache : public BaseCache
 
     void memWriteback();
     void writebackAllTiming();
+    bool writebackTiming(Addr addr);
     void memInvalidate();
     bool isDirty() const;
 
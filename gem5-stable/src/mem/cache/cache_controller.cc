@@ -3,16 +3,91 @@
 
 #include "mem/cache/cache_controller.h"
 
-void CacheController::DirtyBlock(uint64_t addr, int size) {
-  assert(blocks_.size() <= att_length_);
+void CacheController::Track(CacheState& state, uint64_t addr) {
+  std::unordered_map<uint64_t, Block>::iterator it = state.blocks.find(addr);
+  if (it != state.blocks.end()) {
+    ++it->second.writes;
+    it->second.last_write = curTick();
+    state.lrw.splice(state.lrw.end(), state.lrw, it->second.lrw_pos);
+    return;
+  }
+  // A block back from the stream is already counted.
+  const bool streamed = Unstream(state, addr);
+  // The ATT may take fewer than those tracked, e.g., in checkpointing.
+  if (!streamed && num_blocks_ && num_blocks_ >= att_free_) {
+    Flush();
+  }
+  state.lrw.push_back(addr);
+  state.blocks[addr] = Block{1, curTick(), --state.lrw.end()};
+  if (!streamed) ++num_blocks_;
+  if (clean_high_ && num_blocks_ >= clean_high_ &&
+      !clean_event_.scheduled()) {
+    schedule(clean_event_, curTick());
+  }
+}
+
+void CacheController::DirtyBlock(BaseCache* cache, uint64_t addr,
+    int size) {
+  assert(num_blocks_ <= att_length_);
+  CacheState& state = caches_[cache_index_.at(cache)];
   uint64_t begin = addr & ~block_mask();
   uint64_t end = (addr + size - 1) & ~block_mask();
   for (uint64_t a = begin; a <= end; a += block_size()) {
-    if (blocks_.size() == att_length_ && blocks_.find(a) == blocks_.end()) {
-      Flush();
+    Track(state, a);
+  }
+}
+
+void CacheController::CleanStep() {
+  if (num_blocks_ <= clean_low_) return;
+  CacheState* oldest = NULL;
+  for (CacheState& state : caches_) {
+    if (state.lrw.empty() || !state.cache->isMemSideIdle()) continue;
+    if (!oldest || state.blocks.at(state.lrw.front()).last_write <
+        oldest->blocks.at(oldest->lrw.front()).last_write) {
+      oldest = &state;
     }
-    ++blocks_[a];
   }
+  if (oldest) {
+    const uint64_t addr = oldest->lrw.front();
+    num_cleaned_blocks_ += oldest->cache->writebackTiming(addr);
+    oldest->blocks.erase(addr);
+    oldest->lrw.pop_front();
+    --num_blocks_;
+  }
+  schedule(clean_event_, curTick() + clean_interval_);
+}
+
+void CacheController::OnATTUpdate(int free, int dirty) {
+  assert(free >= 0 && free <= att_length_ && dirty <= att_length_);
+  att_free_ = free;
+  att_dirty_ = dirty;
+}
+
+void CacheController::OnEpochBegin() {
+  ++num_epochs_;
+  if (epoch_flush_ && num_blocks_) {
+    Flush();
+  }
+}
+
+void CacheController::regStats() {
+  SimObject::regStats();
+
+  num_flushes_
+      .name(name() + ".num_flushes")
+      .desc("Number of flushes of the tracked dirty blocks");
+  num_flushed_blocks_
+      .name(name() + ".num_flushed_blocks")
+      .desc("Number of dirty blocks written back by flushes");
+  num_forced_blocks_
+      .name(name() + ".num_forced_blocks")
+      .desc("Number of blocks written back at once as a flush fell behind");
+  num_cleaned_blocks_
+      .name(name() + ".num_cleaned_blocks")
+      .desc("Number of least recently written blocks cleaned early");
+  num_epochs_
+      .name(name() + ".num_epochs")
+      .desc("Number of epochs of the memory begun");
 }
 
 CacheController* CacheControllerParams::create() {
@@ -5,6 +5,9 @@
 #define SEXAIN_CACHE_CONTROLLER_H_
 
 #include <vector>
+#include <list>
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <cassert>
 
@@ -12,50 +15,183 @@
 #include "mem/abstract_mem.hh"
 #include "params/CacheController.hh"
 
-class CacheController : public SimObject {
+/// Tracks dirty blocks of the caches registered, e.g., the private caches
+/// of all cores at a level, so that they together never hold more dirty
+/// blocks than the ATT entries left in the epoch, as the memory publishes.
+/// Once the budget is used up, all the caches flush their tracked blocks in
+/// parallel. Past a high watermark, the least recently written blocks are
+/// cleaned early when the bus is idle.
+class CacheController : public SimObject, public ATTObserver {
  public:
   CacheController(const CacheControllerParams* p);
 
   void RegisterCache(BaseCache* const cache);
-  void DirtyBlock(uint64_t addr, int size);
+  void DirtyBlock(BaseCache* cache, uint64_t addr, int size);
+  void regStats();
+
+  void OnATTUpdate(int free, int dirty);
+  void OnEpochBegin();
 
   int block_size() const { return block_size_; }
   uint64_t block_mask() const { return block_mask_; }
   int att_length() const { return att_length_; }
+  /// ATT entries left for versions new to the epoch
+  int att_free() const { return att_free_; }
+  /// Versions written in the epoch
+  int att_dirty() const { return att_dirty_; }
+  int num_caches() const { return caches_.size(); }
+  /// If the memory takes a write of the block without a new ATT entry
+  bool AbsorbsWrite(uint64_t addr) { return memory_->absorbsWrite(addr); }
 
  private:
+  struct Block {
+    int writes;
+    Tick last_write;
+    std::list<uint64_t>::iterator lrw_pos;
+  };
+
+  struct CacheState {
+    BaseCache* cache;
+    std::unordered_map<uint64_t, Block> blocks; ///< Tracked dirty blocks
+    std::list<uint64_t> lrw; ///< Least recently written first
+    std::vector<uint64_t> flushing; ///< Blocks left in the stream
+  };
+
+  /// Removes a block re-dirtied before the stream reaches it,
+  /// and returns if it is found
+  bool Unstream(CacheState& state, uint64_t addr);
+
+  void Track(CacheState& state, uint64_t addr);
+
+  /// Writes back the tracked blocks of all caches as background streams
   void Flush();
+  /// Writes back the next blocks of each stream
+  void FlushStep();
+  /// Writes back at most @num blocks of the stream of a cache,
+  /// and returns the number of those found dirty
+  int Writeback(CacheState& state, int num);
+  /// Writes back the least recently written block of all idle caches
+  void CleanStep();
 
   AbstractMemory* memory_;
-  BaseCache* cache_;
+  std::vector<CacheState> caches_;
+  std::unordered_map<const BaseCache*, int> cache_index_;
+  int num_blocks_; ///< Tracked or left in streams over all caches
+  int att_free_; ///< Budget of num_blocks_
+  int att_dirty_;
 
-  std::unordered_map<uint64_t, int> blocks_;
   const int block_bits_;
   const int att_length_;
   int block_size_;
   uint64_t block_mask_;
+
+  const int flush_blocks_; ///< Per step and cache, or zero to flush at once
+  const Tick flush_interval_;
+  EventWrapper<CacheController, &CacheController::FlushStep> flush_event_;
+
+  const int clean_high_; ///< In blocks, zero if not cleaning early
+  const int clean_low_;
+  const Tick clean_interval_;
+  EventWrapper<CacheController, &CacheController::CleanStep> clean_event_;
+
+  const bool epoch_flush_;
+
+  Stats::Scalar num_flushes_;
+  Stats::Scalar num_flushed_blocks_;
+  Stats::Scalar num_forced_blocks_;
+  Stats::Scalar num_cleaned_blocks_;
+  Stats::Scalar num_epochs_;
 };
 
 inline CacheController::CacheController(const CacheControllerParams* p) :
-    SimObject(p), memory_(p->memory), cache_(NULL),
-    block_bits_(p->block_bits), att_length_(p->att_length) {
+    SimObject(p), memory_(p->memory), num_blocks_(0),
+    att_free_(p->att_length), att_dirty_(0),
+    block_bits_(p->block_bits), att_length_(p->att_length),
+    flush_blocks_(p->flush_blocks), flush_interval_(p->flush_interval),
+    flush_event_(this),
+    clean_high_(p->clean_high * p->att_length),
+    clean_low_(p->clean_low * p->att_length),
+    clean_interval_(p->clean_interval), clean_event_(this),
+    epoch_flush_(p->epoch_flush) {
 
   assert(memory_);
 
   assert(block_bits_ > 0 && att_length_ > 0);
   block_size_ = (1 << block_bits_);
   block_mask_ = block_size_ - 1;
+  assert(clean_high_ <= att_length_);
+  assert(!clean_high_ || clean_low_ <= clean_high_);
+  memory_->AddATTObserver(this);
 }
 
 inline void CacheController::RegisterCache(BaseCache* const cache) {
-  assert(!cache_);
-  cache_ = cache;
+  assert(!cache_index_.count(cache));
+  cache_index_[cache] = caches_.size();
+  caches_.push_back(CacheState());
+  caches_.back().cache = cache;
   memory_->OnCacheRegister();
 }
 
+inline int CacheController::Writeback(CacheState& state, int num) {
+  int written = 0;
+  for (; num && !state.flushing.empty(); --num) {
+    // Blocks evicted or flushed since are skipped.
+    written += state.cache->writebackTiming(state.flushing.back());
+    state.flushing.pop_back();
+    --num_blocks_;
+  }
+  return written;
+}
+
 inline void CacheController::Flush() {
-  cache_->writebackAllTiming();
-  blocks_.clear();
+  if (flush_event_.scheduled()) { // the last streams fall behind
+    for (CacheState& state : caches_) {
+      int forced = Writeback(state, state.flushing.size());
+      num_forced_blocks_ += forced;
+      num_flushed_blocks_ += forced;
+    }
+    deschedule(flush_event_);
+  }
+  for (CacheState& state : caches_) {
+    assert(state.flushing.empty());
+    for (const auto& block : state.blocks) {
+      state.flushing.push_back(block.first);
+    }
+    // Ascending from the back, for row buffer locality
+    std::sort(state.flushing.rbegin(), state.flushing.rend());
+    state.blocks.clear();
+    state.lrw.clear();
+  }
+  ++num_flushes_;
+  // Blocks in the streams still take ATT entries once written back,
+  // so streams that use up the budget are written back at once.
+  if (flush_blocks_ && num_blocks_ < att_free_) {
+    schedule(flush_event_, curTick());
+  } else {
+    for (CacheState& state : caches_) {
+      num_flushed_blocks_ += Writeback(state, state.flushing.size());
+    }
+  }
+}
+
+inline bool CacheController::Unstream(CacheState& state, uint64_t addr) {
+  std::vector<uint64_t>& stream = state.flushing;
+  std::vector<uint64_t>::iterator it = std::lower_bound(
+      stream.begin(), stream.end(), addr, std::greater<uint64_t>());
+  if (it == stream.end() || *it != addr) return false;
+  stream.erase(it);
+  return true;
+}
+
+inline void CacheController::FlushStep() {
+  bool more = false;
+  for (CacheState& state : caches_) {
+    num_flushed_blocks_ += Writeback(state, flush_blocks_);
+    more |= !state.flushing.empty();
+  }
+  if (more) {
+    schedule(flush_event_, curTick() + flush_interval_);
+  }
 }
 
 #endif // SEXAIN_CACHE_CONTROLLER_H_
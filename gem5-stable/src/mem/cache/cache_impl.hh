@@ -142,7 +142,7 @@ Cache<TagStore>::cmpAndSwap(BlkType *blk, PacketPtr pkt)
         std::memcpy(blk_data, &overwrite_val, pkt->getSize());
         blk->status |= BlkDirty;
         if (controller) {
-            controller->DirtyBlock(pkt->getAddr(), pkt->getSize());
+            controller->DirtyBlock(this, pkt->getAddr(), pkt->getSize());
         }
     }
 }
@@ -173,7 +173,7 @@ Cache<TagStore>::satisfyCpuSideRequest(PacketPtr pkt, BlkType *blk,
             pkt->writeDataToBlock(blk->data, blkSize);
             blk->status |= BlkDirty;
             if (controller) {
-                controller->DirtyBlock(pkt->getAddr(), pkt->getSize());
+                controller->DirtyBlock(this, pkt->getAddr(), pkt->getSize());
             }
         }
     } else if (pkt->isRead()) {
@@ -348,7 +348,7 @@ Cache<TagStore>::access(PacketPtr pkt, BlkType *&blk,
         std::memcpy(blk->data, pkt->getPtr<uint8_t>(), blkSize);
         blk->status |= BlkDirty;
         if (controller) {
-            controller->DirtyBlock(pkt->getAddr(), pkt->getSize());
+            controller->DirtyBlock(this, pkt->getAddr(), pkt->getSize());
         }
         if (pkt->isSupplyExclusive()) {
             blk->status |= BlkWritable;
@@ -1113,6 +1113,17 @@ Cache<TagStore>::writebackAllTiming()
     tags->forEachBlk(visitor);
 }
 
+template<class TagStore>
+bool
+Cache<TagStore>::writebackTiming(Addr addr)
+{
+    BlkType *blk = tags->findBlock(addr);
+    if (!blk || !blk->isDirty())
+        return false;
+    writebackTimingVisitor(*blk);
+    return true;
+}
+
 template<class TagStore>
 void
 Cache<TagStore>::memInvalidate()
@@ -1289,7 +1300,7 @@ Cache<TagStore>::handleFill(PacketPtr pkt, BlkType *blk,
         if (pkt->memInhibitAsserted()) {
             blk->status |= BlkDirty;
             if (controller) {
-                controller->DirtyBlock(pkt->getAddr(), pkt->getSize());
+                controller->DirtyBlock(this, pkt->getAddr(), pkt->getSize());
             }
         }
     }
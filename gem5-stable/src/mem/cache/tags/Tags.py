@@ -58,6 +58,9 @@ class LRU(BaseTags):
     cxx_class = 'LRU'
     cxx_header = "mem/cache/tags/lru.hh"
     assoc = Param.Int(Parent.assoc, "associativity")
+    victim_window = Param.Unsigned(0, "LRU ways searched for a clean "
+            "victim or one whose writeback needs no new ATT entry "
+            "(0 for plain LRU)")
 
 class FALRU(BaseTags):
     type = 'FALRU'
@@ -45,6 +45,7 @@
  * Definitions of LRU tag store.
  */
 
+#include <algorithm>
 #include <string>
 
 #include "base/intmath.hh"
@@ -52,13 +53,15 @@
 #include "debug/CacheRepl.hh"
 #include "mem/cache/tags/lru.hh"
 #include "mem/cache/base.hh"
+#include "mem/cache/cache_controller.h"
 #include "sim/core.hh"
 
 using namespace std;
 
 LRU::LRU(const Params *p)
     :BaseTags(p), assoc(p->assoc),
-     numSets(p->size / (p->block_size * p->assoc))
+     numSets(p->size / (p->block_size * p->assoc)),
+     victimWindow(std::min<unsigned>(p->victim_window, p->assoc))
 {
     // Check parameters
     if (blkSize < 4 || !isPowerOf2(blkSize)) {
@@ -164,6 +167,21 @@ LRU::findVictim(Addr addr, PacketList &writebacks)
     // grab a replacement candidate
     BlkType *blk = sets[set].blks[assoc-1];
 
+    // Prefer a less recently used block that is clean or absorbed by
+    // the ATT over a dirty block that takes a new ATT entry.
+    if (victimWindow && blk->isDirty() && cache->controller &&
+        !cache->controller->AbsorbsWrite(regenerateBlkAddr(blk->tag, set))) {
+        for (unsigned i = 2; i <= victimWindow; ++i) {
+            BlkType *b = sets[set].blks[assoc-i];
+            if (!b->isDirty() || cache->controller->AbsorbsWrite(
+                    regenerateBlkAddr(b->tag, set))) {
+                blk = b;
+                ++attAwareVictims;
+                break;
+            }
+        }
+    }
+
     if (blk->isValid()) {
         DPRINTF(CacheRepl, "set %x: selecting blk %x for replacement\n",
                 set, regenerateBlkAddr(blk->tag, set));
@@ -171,6 +189,18 @@ LRU::findVictim(Addr addr, PacketList &writebacks)
     return blk;
 }
 
+void
+LRU::regStats()
+{
+    BaseTags::regStats();
+
+    attAwareVictims
+        .name(name() + ".att_aware_victims")
+        .desc("Number of victims chosen over the LRU block to avoid "
+              "new ATT entries")
+        ;
+}
+
 void
 LRU::insertBlock(PacketPtr pkt, BlkType *blk)
 {
@@ -81,6 +81,11 @@ class LRU : public BaseTags
     const unsigned assoc;
     /** The number of sets in the cache. */
     const unsigned numSets;
+    /** LRU ways searched for a victim that avoids a new ATT entry. */
+    const unsigned victimWindow;
+
+    /** Victims chosen over the LRU block to avoid new ATT entries. */
+    Stats::Scalar attAwareVictims;
 
     /** The cache sets. */
     SetType *sets;
@@ -114,6 +119,8 @@ public:
      */
     virtual ~LRU();
 
+    void regStats();
+
     /**
      * Return the block size.
      * @return the block size.
@@ -0,0 +1 @@
+../../../crash_recovery.cc
\ No newline at end of file
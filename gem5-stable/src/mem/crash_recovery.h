@@ -0,0 +1 @@
+../../../crash_recovery.h
\ No newline at end of file
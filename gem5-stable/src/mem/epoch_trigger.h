@@ -0,0 +1 @@
+../../../epoch_trigger.h
\ No newline at end of file
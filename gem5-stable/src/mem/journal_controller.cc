@@ -0,0 +1 @@
+../../../journal_controller.cc
\ No newline at end of file
@@ -0,0 +1 @@
+../../../journal_controller.h
\ No newline at end of file
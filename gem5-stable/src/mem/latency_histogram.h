@@ -0,0 +1 @@
+../../../latency_histogram.h
\ No newline at end of file
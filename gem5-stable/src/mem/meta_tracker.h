@@ -0,0 +1 @@
+../../../meta_tracker.h
\ No newline at end of file
@@ -39,18 +39,27 @@
  */
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/user.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <zlib.h>
 
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#endif
+
+#include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <string>
 
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/BusAddrRanges.hh"
 #include "debug/Checkpoint.hh"
@@ -152,9 +161,9 @@ PhysicalMemory::createBackingStore(AddrRange range,
     DPRINTF(BusAddrRanges, "Creating backing store for range %s with size %d\n",
             range.to_string(), range.size());
     int map_flags = MAP_ANON | MAP_PRIVATE;
-    uint8_t* pmem = (uint8_t*) mmap(NULL, host_size,
-                                    PROT_READ | PROT_WRITE,
-                                    map_flags, -1, 0);
+    if (_memories[0]->isSparse())
+        map_flags |= MAP_NORESERVE;
+    uint8_t* pmem = mapBackingStore(_memories[0], host_size, map_flags);
 
     if (pmem == (uint8_t*) MAP_FAILED) {
         perror("mmap");
@@ -166,6 +175,9 @@ PhysicalMemory::createBackingStore(AddrRange range,
     // remember this backing store so we can checkpoint it and unmap
     // it appropriately
     backingSize.push_back(make_pair(pmem, host_size));
+    backingFlags.push_back(map_flags);
+    backingMemory.push_back(_memories[0]);
+    placeBackingStore(pmem, backingMemory.size() - 1);
 
     // point the memories to their backing store, and if requested,
     // initialize the memory range to 0
@@ -178,6 +190,90 @@ PhysicalMemory::createBackingStore(AddrRange range,
     }
 }
 
+/**
+ * The default size of hugetlb pages on the host, e.g., 2MB on x86,
+ * or zero if unknown.
+ */
+static uint64_t
+hugetlbPageSize()
+{
+    ifstream meminfo("/proc/meminfo");
+    string line;
+    unsigned long size;
+    while (getline(meminfo, line)) {
+        if (sscanf(line.c_str(), "Hugepagesize: %lu kB", &size) == 1)
+            return uint64_t(size) << 10;
+    }
+    return 0;
+}
+
+uint8_t*
+PhysicalMemory::mapBackingStore(const AbstractMemory* memory,
+                                uint64_t& host_size, int& map_flags)
+{
+#ifdef MAP_HUGETLB
+    if (memory->params()->huge_pages == Enums::hugetlb) {
+        static const uint64_t huge_page = hugetlbPageSize();
+        if (huge_page) {
+            // In whole huge pages, so that munmap takes the same length
+            host_size = roundUp(host_size, huge_page);
+            uint8_t* pmem = (uint8_t*) mmap(NULL, host_size,
+                    PROT_READ | PROT_WRITE, map_flags | MAP_HUGETLB, -1, 0);
+            if (pmem != (uint8_t*) MAP_FAILED) {
+                map_flags |= MAP_HUGETLB;
+                return pmem;
+            }
+        }
+        warn("%s: hugetlb pages are unavailable, "
+             "falling back to transparent huge pages\n", memory->name());
+    }
+#endif
+    return (uint8_t*) mmap(NULL, host_size, PROT_READ | PROT_WRITE,
+                           map_flags, -1, 0);
+}
+
+void
+PhysicalMemory::placeBackingStore(uint8_t* pmem, unsigned store_id)
+{
+    uint64_t host_size = backingSize[store_id].second;
+    const AbstractMemory* memory = backingMemory[store_id];
+    const AbstractMemory::Params* p = memory->params();
+#ifdef MADV_HUGEPAGE
+    // Also the fallback of hugetlb pages
+    if (p->huge_pages != Enums::none &&
+        !(backingFlags[store_id] & MAP_HUGETLB) &&
+        madvise(pmem, host_size, MADV_HUGEPAGE) != 0) {
+        warn("%s: transparent huge pages are unavailable (%s)\n",
+             memory->name(), strerror(errno));
+    }
+#endif
+
+    if (p->numa_policy == Enums::local)
+        return;
+    if (p->numa_nodes.empty())
+        fatal("%s: NUMA policy %s needs the nodes\n", memory->name(),
+              Enums::NumaPolicyStrings[p->numa_policy]);
+#ifdef SYS_mbind
+    // By the system call rather than libnuma, which may not be there
+    const int bits = sizeof(unsigned long) * CHAR_BIT;
+    unsigned max_node = *max_element(p->numa_nodes.begin(),
+                                     p->numa_nodes.end());
+    vector<unsigned long> node_mask(max_node / bits + 1, 0);
+    for (vector<unsigned>::const_iterator n = p->numa_nodes.begin();
+         n != p->numa_nodes.end(); ++n)
+        node_mask[*n / bits] |= 1UL << (*n % bits);
+    int mode = p->numa_policy == Enums::bind ? MPOL_BIND : MPOL_INTERLEAVE;
+    if (syscall(SYS_mbind, pmem, host_size, mode, &node_mask[0],
+                node_mask.size() * bits + 1, 0) != 0) {
+        warn("%s: mbind failed on the backing store (%s)\n",
+             memory->name(), strerror(errno));
+    }
+#else
+    warn("%s: NUMA policies are not supported on this host\n",
+         memory->name());
+#endif
+}
+
 PhysicalMemory::~PhysicalMemory()
 {
     // unmap the backing store
@@ -420,13 +516,19 @@ PhysicalMemory::unserializeStore(Checkpoint* cp, const string& section)
         fatal("Memory range size has changed! Saw %lld, expected %lld\n",
               range_size, range.size());
 
-    pmem = (uint8_t*) mmap(NULL, host_size, PROT_READ | PROT_WRITE,
-                           MAP_ANON | MAP_PRIVATE, -1, 0);
+    // Hugetlb pages may have run out since, which falls back as well.
+    int map_flags = backingFlags[store_id];
+#ifdef MAP_HUGETLB
+    map_flags &= ~MAP_HUGETLB;
+#endif
+    pmem = mapBackingStore(backingMemory[store_id], host_size, map_flags);
 
     if (pmem == (void*) MAP_FAILED) {
         perror("mmap");
         fatal("Could not mmap physical memory!\n");
     }
+    backingFlags[store_id] = map_flags;
+    placeBackingStore(pmem, store_id);
 
     uint64_t curr_size = 0;
     long* temp_page = new long[chunk_size];
@@ -89,6 +89,10 @@ class PhysicalMemory : public Serializable
     std::vector<std::pair<AddrRange, uint8_t*> > backingStore;
     // The backing store and its size
     std::vector<std::pair<uint8_t*, uint64_t> > backingSize;
+    // The mmap flags of the backing store, e.g., if sparse
+    std::vector<int> backingFlags;
+    // The memory whose parameters place the backing store
+    std::vector<const AbstractMemory*> backingMemory;
 
     // Prevent copying
     PhysicalMemory(const PhysicalMemory&);
@@ -107,6 +111,27 @@ class PhysicalMemory : public Serializable
     void createBackingStore(AddrRange range,
                             const std::vector<AbstractMemory*>& _memories);
 
+    /**
+     * Map a backing store for a memory, in hugetlb pages if it asks
+     * for them and the host has enough, or else in normal pages.
+     *
+     * @param memory The memory whose parameters pick the pages
+     * @param host_size The size, rounded up to whole hugetlb pages if used
+     * @param map_flags The mmap flags, plus MAP_HUGETLB if used
+     * @return The backing store, or MAP_FAILED
+     */
+    uint8_t* mapBackingStore(const AbstractMemory* memory,
+                             uint64_t& host_size, int& map_flags);
+
+    /**
+     * Apply the huge page advice and the NUMA policy of a memory to
+     * its newly mapped backing store, before any page is touched.
+     *
+     * @param pmem The backing store, mapped anew
+     * @param store_id Its index, e.g., for its size and memory
+     */
+    void placeBackingStore(uint8_t* pmem, unsigned store_id);
+
   public:
 
     /**
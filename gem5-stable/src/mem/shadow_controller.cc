@@ -0,0 +1 @@
+../../../shadow_controller.cc
\ No newline at end of file
@@ -0,0 +1 @@
+../../../shadow_controller.h
\ No newline at end of file
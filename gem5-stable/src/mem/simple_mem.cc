@@ -42,9 +42,11 @@
  *          Andreas Hansson
  */
 
+#include "base/callback.hh"
 #include "base/random.hh"
 #include "mem/simple_mem.hh"
 #include "debug/RowBuffer.hh"
+#include "sim/sim_exit.hh"
 
 using namespace std;
 
@@ -54,16 +56,42 @@ SimpleMemory::SimpleMemory(const SimpleMemoryParams* p) :
     latency_miss(p->latency_miss), banks(uint64_t(1) << ceilLog2(hostSize())),
     tATTOp(p->lat_att_operate), tBufferOp(p->lat_buffer_operate),
     tNVMRead(p->lat_nvm_read), tNVMWrite(p->lat_nvm_write),
+    tWCB(p->lat_wcb), tTransCache(p->lat_trans_cache),
+    nvmWriteMode(p->nvm_write_mode),
+    nvmWriteUnit(p->nvm_write_unit), writeBuffer(p->wcb_entries),
     latency_var(p->latency_var), bandwidth(p->bandwidth),
-    isBusy(false), retryReq(false), retryResp(false),
+    isBusy(false), idleEvent(this), retryReq(false), retryResp(false),
     releaseEvent(this), freezeEvent(this), unfreezeEvent(this),
-    dequeueEvent(this), drainManager(NULL)
+    dequeueEvent(this), crashTime(p->crash_time), powerFailEvent(this),
+    drainManager(NULL)
 {
+    if (crashTime && !crashRecovery)
+        fatal("%s: crash_time needs crash_recovery\n", name());
     isTiming = !p->disable_timing;
     wbBandwidth = (double)latency / 64;
     waitStart = 0;
-    ckptStart = 0;
+    stallDelay = 0;
     profBase.set_op_latency(p->lat_att_operate);
+    addrController.set_trans_caches(p->att_cache_entries,
+            p->ptt_cache_entries, p->trans_cache_assoc);
+
+    switch (p->epoch_trigger) {
+      case Enums::interval:
+        epochTrigger = new IntervalTrigger(p->epoch_interval);
+        break;
+      case Enums::writes:
+        epochTrigger = new WriteBudgetTrigger(p->epoch_writes);
+        break;
+      case Enums::adaptive:
+        epochTrigger = new AdaptiveTrigger(p->epoch_overhead,
+                                           p->epoch_max_ckpt);
+        break;
+      case Enums::idle:
+        epochTrigger = new IdleTrigger(p->epoch_idle);
+        break;
+      default:
+        epochTrigger = new FootprintTrigger();
+    }
 }
 
 void
@@ -76,6 +104,13 @@ SimpleMemory::init()
     }
 }
 
+void
+SimpleMemory::startup()
+{
+    if (crashTime)
+        schedule(powerFailEvent, crashTime);
+}
+
 void
 SimpleMemory::regStats()
 {
@@ -91,6 +126,120 @@ SimpleMemory::regStats()
     totalWaitTime
         .name(name() + ".total_wait_time")
         .desc("Total wait time in checkpointing frames");
+    numTriggeredEpochs
+        .name(name() + ".num_triggered_epochs")
+        .desc("Number of epochs ended by the trigger policy");
+    numMetaBlocks
+        .name(name() + ".num_meta_blocks")
+        .desc("Number of modified ATT and PTT blocks checkpointed");
+
+    recoveryVerifiedBlocks
+        .name(name() + ".recovery_verified_blocks")
+        .desc("Number of blocks verified after recovery");
+    recoveryMismatches
+        .name(name() + ".recovery_mismatches")
+        .desc("Number of recovered blocks that differ from the last "
+              "finished checkpoint");
+    recoveryRemappedBlocks
+        .name(name() + ".recovery_remapped_blocks")
+        .desc("Number of blocks recovered from version buffer slots");
+    recoveryPages
+        .name(name() + ".recovery_pages")
+        .desc("Number of DRAM pages recovered from their NVM copies");
+    recoveryTime
+        .name(name() + ".recovery_time")
+        .desc("Time to read the ATT and PTT and restore recovered blocks");
+
+    wcbWriteHits
+        .name(name() + ".wcb_write_hits")
+        .desc("Number of NVM writes combined in the write buffer "
+              "(saved NVM writes)");
+    wcbWriteMisses
+        .name(name() + ".wcb_write_misses")
+        .desc("Number of NVM writes allocated in the write buffer");
+    wcbReadHits
+        .name(name() + ".wcb_read_hits")
+        .desc("Number of NVM reads forwarded from the write buffer");
+    wcbEvictions
+        .name(name() + ".wcb_evictions")
+        .desc("Number of blocks written back on write buffer eviction");
+    wcbFlushes
+        .name(name() + ".wcb_flushes")
+        .desc("Number of blocks written back at epoch ends");
+    wcbHitRate
+        .name(name() + ".wcb_hit_rate")
+        .desc("Write hit rate of the write buffer")
+        .precision(4)
+        .prereq(wcbWriteMisses);
+    wcbHitRate = wcbWriteHits / (wcbWriteHits + wcbWriteMisses);
+
+    attCacheHits
+        .name(name() + ".att_cache_hits")
+        .desc("Number of ATT lookups hit in the controller cache");
+    attCacheMisses
+        .name(name() + ".att_cache_misses")
+        .desc("Number of ATT lookups that read the table in DRAM");
+    pttCacheHits
+        .name(name() + ".ptt_cache_hits")
+        .desc("Number of PTT lookups hit in the controller cache");
+    pttCacheMisses
+        .name(name() + ".ptt_cache_misses")
+        .desc("Number of PTT lookups that read the table in DRAM");
+    attCacheHitRate
+        .name(name() + ".att_cache_hit_rate")
+        .desc("Hit rate of the ATT cache")
+        .precision(4)
+        .prereq(attCacheMisses);
+    attCacheHitRate = attCacheHits / (attCacheHits + attCacheMisses);
+    pttCacheHitRate
+        .name(name() + ".ptt_cache_hit_rate")
+        .desc("Hit rate of the PTT cache")
+        .precision(4)
+        .prereq(pttCacheMisses);
+    pttCacheHitRate = pttCacheHits / (pttCacheHits + pttCacheMisses);
+
+    nvmComparedBits
+        .name(name() + ".nvm_compared_bits")
+        .desc("Number of bits of NVM block writes compared");
+    nvmProgrammedBits
+        .name(name() + ".nvm_programmed_bits")
+        .desc("Number of bits programmed by NVM block writes");
+    nvmChangedWords
+        .name(name() + ".nvm_changed_words")
+        .desc("Number of 32-bit words changed by NVM block writes");
+    nvmFlippedWords
+        .name(name() + ".nvm_flipped_words")
+        .desc("Number of words stored inverted by Flip-N-Write");
+    nvmSilentWrites
+        .name(name() + ".nvm_silent_writes")
+        .desc("Number of NVM block writes that change no bits");
+    nvmProgrammedRatio
+        .name(name() + ".nvm_programmed_ratio")
+        .desc("Ratio of programmed bits to compared bits")
+        .precision(4)
+        .prereq(nvmComparedBits);
+    nvmProgrammedRatio = nvmProgrammedBits / nvmComparedBits;
+
+    static const char* tail_names[] = { "p50", "p99", "p999" };
+    static const double tail_ratios[] = { 0.5, 0.99, 0.999 };
+    for (int i = 0; i < Profiler::NUM_PATHS; ++i) {
+        string path = Profiler::path_strings[i];
+        pathLatency[i]
+            .init(32)
+            .name(name() + ".latency_" + path)
+            .desc("Response latency of path " + path + " (ticks)")
+            .flags(nozero | nonan);
+        for (int j = 0; j < NUM_TAILS; ++j) {
+            pathTails[i][j].set(&pathHist[i], tail_ratios[j]);
+            pathLatencyTail[i][j]
+                .functor(pathTails[i][j])
+                .name(name() + ".latency_" + path + "_" + tail_names[j])
+                .desc(string(tail_names[j]) + " response latency of path " +
+                      path + " (ticks)");
+        }
+    }
+    Stats::registerResetCallback(new MakeCallback<SimpleMemory,
+            &SimpleMemory::resetPathLatency>(this));
 
     readRowHits
         .name(name() + ".readRowHits")
@@ -112,7 +261,7 @@ SimpleMemory::regStats()
 Tick
 SimpleMemory::recvAtomic(PacketPtr pkt)
 {
-    access(pkt, Profiler::Null);
+    access(pkt);
     return pkt->memInhibitAsserted() ? 0 : getLatency();
 }
 
@@ -148,23 +297,38 @@ void
 SimpleMemory::clearWait()
 {
     assert(isWait());
-    totalWaitTime += curTick() - waitStart;
+    stallDelay = curTick() - waitStart;
+    totalWaitTime += stallDelay;
     waitStart = 0;
 }
 
+void
+SimpleMemory::samplePathLatency(Profiler::Path path, Tick lat)
+{
+    pathLatency[path].sample(lat);
+    pathHist[path].Sample(lat);
+}
+
+void
+SimpleMemory::resetPathLatency()
+{
+    for (int i = 0; i < Profiler::NUM_PATHS; ++i) {
+        pathHist[i].Reset();
+    }
+}
+
 void
 SimpleMemory::setCkptStart(Tick time)
 {
-    assert(ckptStart == 0);
-    ckptStart = time;
+    ckptStarts.push_back(time);
 }
 
 Tick
 SimpleMemory::getCkptTime()
 {
-    assert(ckptStart > 0);
-    Tick time = curTick() - ckptStart;
-    ckptStart = 0;
+    assert(!ckptStarts.empty());
+    Tick time = curTick() - ckptStarts.front();
+    ckptStarts.pop_front();
     return time;
 }
 
@@ -200,22 +364,13 @@ SimpleMemory::recvTimingReq(PacketPtr pkt)
 
     if (pkt->cmd != MemCmd::SwapReq && pkt->isWrite()) {
         Control ctrl = addrController.Probe(pkt->getAddr());
+        if (ctrl == REG_WRITE && addrController.ckpt_available() &&
+                epochTrigger->Fire(curTick(), estimateCkptTime())) {
+            ++numTriggeredEpochs;
+            ctrl = NEW_EPOCH;
+        }
         if (ctrl == NEW_EPOCH) {
-            assert(ckptBlocks.empty());
-            Profiler pf(profBase);
-            addrController.MigratePages(ckptBlocks, pf);
-            bytesChannel += pf.SumBusUtil();
-            bytesInterChannel += pf.SumBusUtil(true);
-
-            // ATT and PTT flushes
-            uint64_t area = addrController.att_length() * 8;
-            area += addrController.migrator().ptt_length() * 8;
-            Tick duration = area * wbBandwidth;
-            duration += pf.SumLatency();
-            totalWaitTime += duration;
-            setCkptStart(curTick());
-            schedule(freezeEvent, curTick() + duration);
-            isBusy = true;
+            startEpoch();
             retryReq = true;
             return false;
         } else if (ctrl == WAIT_CKPT) {
@@ -252,6 +407,8 @@ SimpleMemory::recvTimingReq(PacketPtr pkt)
     // go ahead and deal with the packet and put the response in the
     // queue if there is one
     bool needsResponse = pkt->needsResponse();
+    bool isAccess = pkt->isRead() || pkt->isWrite();
+    bool isStalled = pkt->isWrite() && stallDelay;
 
     Profiler pf(profBase);
     access(pkt, pf);
@@ -259,12 +416,26 @@ SimpleMemory::recvTimingReq(PacketPtr pkt)
     bytesInterChannel += pf.SumBusUtil(true);
     ckBusUtil += pf.SumBusUtil();
 
+    if (isAccess) {
+        epochTrigger->OnAccess(curTick(), pkt->isWrite());
+        if (epochTrigger->idle_time()) {
+            reschedule(idleEvent, curTick() + epochTrigger->idle_time(), true);
+        }
+    }
+
+    Tick lat = Profiler::kLatency ? pf.SumLatency() : getLatency();
+    if (isStalled) {
+        samplePathLatency(Profiler::CKPT_STALL, lat + stallDelay);
+        stallDelay = 0;
+    } else if (isAccess) {
+        samplePathLatency(pf.path(), lat);
+    }
+
     // turn packet around to go back to requester if response expected
     if (needsResponse) {
         // recvAtomic() should already have turned packet into
         // atomic response
         assert(pkt->isResponse());
-        Tick lat = pf.SumLatency();
         extraRespLatency += (double)lat - getLatency();
         // to keep things simple (and in order), we put the packet at
         // the end even if the latency suggests it should be sent
@@ -279,6 +450,55 @@ SimpleMemory::recvTimingReq(PacketPtr pkt)
     return true;
 }
 
+void
+SimpleMemory::startEpoch()
+{
+    assert(ckptBlocks.empty() && !isBusy);
+
+    // Buffered NVM writes belong to the ending epoch.
+    int buffered = writeBuffer.Flush(&ckptBlocks);
+    wcbFlushes += buffered;
+    for (int i = 0; i < buffered; ++i)
+        recordNVMWrite(ckptBlocks[i]);
+    bytesChannel += buffered * addrController.block_size();
+
+    Profiler pf(profBase);
+    addrController.MigratePages(ckptBlocks, pf);
+    publishATT();
+    bytesChannel += pf.SumBusUtil();
+    bytesInterChannel += pf.SumBusUtil(true);
+
+    Tick duration = pf.SumLatency();
+    totalWaitTime += duration;
+    setCkptStart(curTick());
+    schedule(freezeEvent, curTick() + duration);
+    isBusy = true;
+}
+
+Tick
+SimpleMemory::estimateCkptTime()
+{
+    // Dirty ATT blocks, buffered writes and dirty DRAM pages,
+    // plus modified ATT and PTT blocks
+    uint64_t blocks = addrController.att_dirty_length() + writeBuffer.size();
+    blocks += (uint64_t)addrController.migrator().num_dirty_entries() *
+            (addrController.page_size() / addrController.block_size());
+    blocks += addrController.meta_dirty_blocks();
+    return blocks * addrController.block_size() * wbBandwidth;
+}
+
+void
+SimpleMemory::idleCheck()
+{
+    // never end an epoch without a backup level for its checkpoint
+    if (isBusy || !addrController.ckpt_available())
+        return;
+    if (epochTrigger->Fire(curTick(), estimateCkptTime())) {
+        ++numTriggeredEpochs;
+        startEpoch();
+    }
+}
+
 void
 SimpleMemory::release()
 {
@@ -304,29 +524,32 @@ SimpleMemory::freeze()
     numDirtyDRAMPages = addrController.migrator().dirty_dram_pages();
     numPagesToDRAM = addrController.pages_to_dram();
     numPagesToNVM = addrController.pages_to_nvm();
+    numPagesStreamed = addrController.pages_streamed();
+    attCacheHits = addrController.att_cache().hits();
+    attCacheMisses = addrController.att_cache().misses();
+    pttCacheHits = addrController.ptt_cache().hits();
+    pttCacheMisses = addrController.ptt_cache().misses();
+    numZeroBlocks = addrController.zero_blocks();
 
     Profiler pf(profBase);
     addrController.BeginCheckpointing(ckptBlocks, pf);
+    epochTrigger->OnEpochStart(curTick());
     bytesChannel += pf.SumBusUtil();
     bytesInterChannel += pf.SumBusUtil(true);
 
-    while(!ckptBlocks.empty()) {
-        banks.PushWrite(ckptBlocks.back());
-        ckptBlocks.pop_back();
-    }
-
-    int flushed;
-    vector<pair<DRAMBanks::Bank*, bool>> b = banks.Access(curTick(), &flushed);
-    ckBusUtil += addrController.block_size() * flushed;
-    for (int i = 0; i < b.size(); ++i) {
-        b[i].first->set_busy_time(curTick() + latency); //TODO
-    }
-    Tick next = banks.NextTime(curTick());
-    assert(!next || next - curTick() == latency); //TODO
-    if (next) {
-        schedule(unfreezeEvent, next);
-    } else {
-        addrController.FinishCheckpointing();
+    // ATT and PTT blocks persist along with the checkpointed data.
+    int meta = addrController.AddMetaBlocks(GetMetaRegionBase(), &ckptBlocks);
+    numMetaBlocks += meta;
+    bytesChannel += meta * addrController.block_size();
+    if (crashRecovery)
+        crashRecovery->OnCheckpointBegin(addrController.ckpt_meta());
+    publishEpoch();
+
+    // The epoch drains after earlier ones while later epochs run.
+    ckptQueue.push_back(vector<Addr>());
+    ckptQueue.back().swap(ckptBlocks);
+    if (ckptQueue.size() == 1) {
+        startDrain();
     }
 
     if (retryReq) {
@@ -349,14 +572,65 @@ SimpleMemory::unfreeze()
     if (next) {
         schedule(unfreezeEvent, next);
     } else {
-        addrController.FinishCheckpointing();
-        assert(ckBusUtil == bytesChannel.value());
-        totalCkptTime += getCkptTime();
-        if (isWait()) {
-            clearWait();
-            port.sendRetry();
-        }
+        finishCkpt();
+    }
+}
+
+void
+SimpleMemory::startDrain()
+{
+    vector<Addr>& blocks = ckptQueue.front();
+    while (!blocks.empty()) {
+        banks.PushWrite(blocks.back());
+        blocks.pop_back();
+    }
+    unfreeze();
+}
+
+void
+SimpleMemory::finishCkpt()
+{
+    addrController.FinishCheckpointing();
+    publishATT();
+    if (crashRecovery)
+        crashRecovery->OnCheckpointFinish();
+    totalCkptTime += getCkptTime();
+    ckptQueue.pop_front();
+    if (!ckptQueue.empty()) {
+        startDrain();
+    } else if (!freezeEvent.scheduled()) {
+        assert(!Profiler::kCounters || ckBusUtil == bytesChannel.value());
     }
+    // a backup level is free for writes waiting for one
+    if (isWait()) {
+        clearWait();
+        port.sendRetry();
+    }
+}
+
+void
+SimpleMemory::powerFail()
+{
+    assert(crashRecovery);
+    RecoveryStats rs = crashRecovery->Recover(pmemAddr);
+    recoveryVerifiedBlocks = rs.blocks;
+    recoveryMismatches = rs.mismatches;
+    recoveryRemappedBlocks = rs.remapped_blocks;
+    recoveryPages = rs.pages;
+
+    // Recovery reads both tables whole, copies remapped blocks home,
+    // and reloads the pages cached in DRAM.
+    const int page_blocks =
+            addrController.page_size() / addrController.block_size();
+    uint64_t bytes = addrController.meta_size();
+    bytes += (rs.remapped_blocks + rs.pages * page_blocks) *
+            addrController.block_size();
+    recoveryTime = bytes * wbBandwidth;
+
+    inform("%s: power failure with %d epochs in checkpointing, "
+           "%lu of %lu blocks mismatched after recovery\n", name(),
+           addrController.ckpt_epochs(), rs.mismatches, rs.blocks);
+    exitSimLoop("power failure");
 }
 
 void
@@ -391,40 +665,16 @@ SimpleMemory::getLatency()
         (latency_var ? random_mt.random<Tick>(0, latency_var) : 0);
 }
 
-Addr
-SimpleMemory::GetVirtMachAddr(Addr mach_addr, bool is_dram, const PTTEntry* page)
-{
-    assert(page || is_dram || mach_addr < addrController.phy_range() +
-            addrController.nvm_buffer().Size());
-    assert(page || !is_dram || addrController.dram_buffer().Contains(mach_addr));
-
-    Addr backup_base = GetVirtRegionBase(); // for the DRAM backup region
-    assert(backup_base >= addrController.Size());
-    Addr cache_base = backup_base + addrController.migrator().dram_capacity();
-    Addr cache_limit = cache_base + addrController.migrator().dram_capacity();
-
-    if (page) {
-        assert(mach_addr < addrController.phy_range());
-        if (is_dram) {
-            Addr mach_base = cache_base +
-                    page->index * addrController.page_size();
-            mach_addr = addrController.migrator().Translate(mach_addr, mach_base);
-            assert(mach_addr >= cache_base && mach_addr < cache_limit);
-        } else if (page->state == PTTEntry::DIRTY_STATIC) {
-            Addr mach_base = backup_base +
-                    page->index * addrController.page_size();
-            mach_addr = addrController.migrator().Translate(mach_addr, mach_base);
-            assert(mach_addr >= backup_base && mach_addr < cache_base);
-        } else assert(page->state == PTTEntry::DIRTY_DIRECT);
-    }
-    return mach_addr;
-}
-
 int64_t
 SimpleMemory::GetReadLatency(Addr mach_addr,
         bool is_dram, const PTTEntry* page)
 {
-    mach_addr = GetVirtMachAddr(mach_addr, is_dram, page);
+    assert(!is_dram || addrController.dram_buffer().Contains(mach_addr) ||
+           mach_addr >= addrController.cache_base());
+    if (!is_dram && writeBuffer.Contains(blockAlign(mach_addr))) {
+        ++wcbReadHits;
+        return tWCB;
+    }
     bool hit;
     DRAMBanks::Bank* bank = banks.Access(mach_addr, hit);
     DPRINTF(RowBuffer, "RowBuffer: Read addr=%lx %d\n", mach_addr, bank != NULL);
@@ -441,17 +691,85 @@ int64_t
 SimpleMemory::GetWriteLatency(Addr mach_addr,
         bool is_dram, const PTTEntry* page)
 {
-    mach_addr = GetVirtMachAddr(mach_addr, is_dram, page);
+    assert(!is_dram || addrController.dram_buffer().Contains(mach_addr) ||
+           mach_addr >= addrController.cache_base());
+    Tick buffered = 0;
+    if (!is_dram && writeBuffer.capacity()) {
+        Addr victim;
+        if (writeBuffer.Write(blockAlign(mach_addr), &victim)) {
+            ++wcbWriteHits;
+            return tWCB;
+        }
+        ++wcbWriteMisses;
+        if (victim == Addr(-EINVAL))
+            return tWCB;
+        // the write waits for the LRU block to make room
+        ++wcbEvictions;
+        mach_addr = victim;
+        buffered = tWCB;
+    }
     bool hit;
     DRAMBanks::Bank* bank = banks.Access(mach_addr, hit);
     DPRINTF(RowBuffer, "RowBuffer: Write addr=%lx %d\n", mach_addr, bank != NULL);
+    // a buffered write evicts some other block, whose data is unknown
+    int bits = -1;
+    if (!is_dram && !buffered && storeData && nvmWriteMode != Enums::full)
+        bits = programmedBits(mach_addr);
+    if (!is_dram && bits)
+        recordNVMWrite(mach_addr);
     if (hit) {
         ++writeRowHits;
-        return latency;
+        return buffered + latency;
     } else {
         ++writeRowMisses;
-        return is_dram ? latency_miss : tNVMWrite;
+        if (is_dram)
+            return buffered + latency_miss;
+        if (bits < 0)
+            return buffered + tNVMWrite;
+        // the old data is read before the changed bits are programmed,
+        // so a silent write only pays for the read
+        const int block_bits = addrController.block_size() * 8;
+        const int rounds = (bits + nvmWriteUnit - 1) / nvmWriteUnit;
+        const int full_rounds = (block_bits + nvmWriteUnit - 1) / nvmWriteUnit;
+        return buffered + tNVMRead + tNVMWrite * rounds / full_rounds;
+    }
+}
+
+int64_t
+SimpleMemory::GetMetaLatency(Addr meta_addr, bool hit)
+{
+    if (hit)
+        return tTransCache;
+    assert(meta_addr < addrController.meta_size());
+    bool row_hit;
+    banks.Access(GetMetaRegionBase() + meta_addr, row_hit);
+    return tTransCache + (row_hit ? latency : latency_miss);
+}
+
+int
+SimpleMemory::programmedBits(Addr mach_addr)
+{
+    const int size = addrController.block_size();
+    const uint32_t* old_words = (const uint32_t*)hostAddr(mach_addr);
+    const uint32_t* new_words = (const uint32_t*)storeData;
+    int bits = 0;
+    for (int i = 0; i < size / 4; ++i) {
+        int diff = __builtin_popcount(old_words[i] ^ new_words[i]);
+        if (!diff)
+            continue;
+        ++nvmChangedWords;
+        // store the inverted word and set its flip bit instead
+        if (nvmWriteMode == Enums::fnw && diff > 16) {
+            diff = 33 - diff;
+            ++nvmFlippedWords;
+        }
+        bits += diff;
     }
+    nvmComparedBits += size * 8;
+    nvmProgrammedBits += bits;
+    if (!bits)
+        ++nvmSilentWrites;
+    return bits;
 }
 
 void
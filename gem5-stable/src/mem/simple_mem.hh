@@ -55,6 +55,9 @@
 #include "mem/abstract_mem.hh"
 #include "mem/port.hh"
 #include "mem/dram_banks.h"
+#include "mem/epoch_trigger.h"
+#include "mem/latency_histogram.h"
+#include "mem/write_buffer.h"
 #include "params/SimpleMemory.hh"
 
 /**
@@ -122,10 +125,35 @@ class SimpleMemory : public AbstractMemory
     DDR3Banks banks;
     std::vector<Addr> ckptBlocks;
 
+    /**
+     * Blocks to write back for each epoch in checkpointing, oldest first.
+     * Only the oldest one is draining in the banks.
+     */
+    std::deque<std::vector<Addr>> ckptQueue;
+
     const Tick tATTOp;
     const Tick tBufferOp;
     const Tick tNVMRead;
     const Tick tNVMWrite;
+    const Tick tWCB;
+    const Tick tTransCache;
+
+    /** NVM write reduction, and bits programmed per write round */
+    const Enums::NVMWriteMode nvmWriteMode;
+    const int nvmWriteUnit;
+
+    /**
+     * Compare the store data with the old contents of an NVM block.
+     *
+     * @return the number of bits to program
+     */
+    int programmedBits(Addr mach_addr);
+
+    /**
+     * Write-combining buffer in front of NVM. Buffered blocks are
+     * written back on eviction and at the end of each epoch.
+     */
+    WriteBuffer writeBuffer;
 
     bool isTiming;
 
@@ -163,10 +191,34 @@ class SimpleMemory : public AbstractMemory
     void setWait();
     void clearWait();
 
-    Tick ckptStart;
+    /** Stall time of the write retried after WAIT_CKPT */
+    Tick stallDelay;
+
+    /** Start time of each epoch in checkpointing, oldest first */
+    std::deque<Tick> ckptStarts;
     void setCkptStart(Tick time);
     Tick getCkptTime();
 
+    /** Policy to end epochs besides a full ATT or PTT */
+    EpochTrigger* epochTrigger;
+
+    /**
+     * Migrate pages and schedule the freeze that begins checkpointing.
+     */
+    void startEpoch();
+
+    /**
+     * Estimate the time to write back the current epoch.
+     */
+    Tick estimateCkptTime();
+
+    /**
+     * Check the epoch trigger after memory has been idle.
+     */
+    void idleCheck();
+
+    EventWrapper<SimpleMemory, &SimpleMemory::idleCheck> idleEvent;
+
     /**
      * Remember if we have to retry an outstanding request that
      * arrived while we were busy.
@@ -195,12 +247,22 @@ class SimpleMemory : public AbstractMemory
     EventWrapper<SimpleMemory, &SimpleMemory::freeze> freezeEvent;
 
     /**
-     * Unfreeze the memory after checkpointing finishes.
+     * Drain checkpoint blocks of the oldest epoch in checkpointing.
      */
     void unfreeze();
 
     EventWrapper<SimpleMemory, &SimpleMemory::unfreeze> unfreezeEvent;
 
+    /**
+     * Push blocks of the oldest epoch in checkpointing to the banks.
+     */
+    void startDrain();
+
+    /**
+     * Finish the oldest epoch in checkpointing after its blocks drain.
+     */
+    void finishCkpt();
+
     /**
      * Dequeue a packet from our internal packet queue and move it to
      * the port where it will be sent as soon as possible.
@@ -209,6 +271,17 @@ class SimpleMemory : public AbstractMemory
 
     EventWrapper<SimpleMemory, &SimpleMemory::dequeue> dequeueEvent;
 
+    /** Time of a simulated power failure, or zero if none */
+    const Tick crashTime;
+
+    /**
+     * Fail power, recover the last finished checkpoint and verify it
+     * against the committed image, then exit the simulation.
+     */
+    void powerFail();
+
+    EventWrapper<SimpleMemory, &SimpleMemory::powerFail> powerFailEvent;
+
     /**
      * Detemine the latency.
      *
@@ -216,13 +289,41 @@ class SimpleMemory : public AbstractMemory
      */
     Tick getLatency();
 
-    Addr GetVirtRegionBase()
+    /** The ATT and PTT in DRAM follow the machine space */
+    Addr GetMetaRegionBase()
     {
         return ((addrController.Size() - 1) & ~(banks.row_buffer_size() - 1)) +
                 banks.row_buffer_size();
     }
 
-    Addr GetVirtMachAddr(Addr mach_addr, bool is_dram, const PTTEntry* page);
+    Addr blockAlign(Addr addr)
+    {
+        return addr & ~Addr(addrController.block_size() - 1);
+    }
+
+    /** Percentiles reported for each translation path */
+    enum { P50 = 0, P99, P999, NUM_TAILS };
+
+    /**
+     * A percentile of a latency histogram, as the functor of a stat value
+     */
+    class LatencyPercentile
+    {
+      private:
+        const LatencyHistogram* hist;
+        double ratio;
+
+      public:
+        LatencyPercentile() : hist(NULL), ratio(0) { }
+        void set(const LatencyHistogram* h, double r) { hist = h; ratio = r; }
+        Stats::Result operator()() const { return hist->Percentile(ratio); }
+    };
+
+    LatencyHistogram pathHist[Profiler::NUM_PATHS];
+    LatencyPercentile pathTails[Profiler::NUM_PATHS][NUM_TAILS];
+
+    void samplePathLatency(Profiler::Path path, Tick lat);
+    void resetPathLatency();
 
     /**
      * @page NULL denotes a request from a NVM physical address.
@@ -232,6 +333,10 @@ class SimpleMemory : public AbstractMemory
      * @page NULL denotes a request from a NVM physical address.
      */
     int64_t GetWriteLatency(Addr mach_addr, bool is_dram, const PTTEntry* page);
+    /**
+     * A miss in the ATT or PTT cache reads the entry from DRAM.
+     */
+    int64_t GetMetaLatency(Addr meta_addr, bool hit);
 
     /** @todo this is a temporary workaround until the 4-phase code is
      * committed. upstream caches needs this packet until true is returned, so
@@ -248,12 +353,14 @@ class SimpleMemory : public AbstractMemory
   public:
 
     SimpleMemory(const SimpleMemoryParams *p);
+    ~SimpleMemory() { delete epochTrigger; }
 
     unsigned int drain(DrainManager *dm);
 
     BaseSlavePort& getSlavePort(const std::string& if_name,
                                 PortID idx = InvalidPortID);
     void init();
+    void startup();
 
     /**
      * Register Statistics
@@ -268,6 +375,46 @@ class SimpleMemory : public AbstractMemory
     Stats::Scalar totalCkptTime;
     /** Total wait time in checkpointing frames */
     Stats::Scalar totalWaitTime;
+    /** Epochs ended by the trigger policy instead of a full ATT or PTT */
+    Stats::Scalar numTriggeredEpochs;
+    /** ATT and PTT blocks written back, with entries modified in epochs */
+    Stats::Scalar numMetaBlocks;
+
+    // Recovery at a simulated power failure
+    Stats::Scalar recoveryVerifiedBlocks;
+    Stats::Scalar recoveryMismatches;
+    Stats::Scalar recoveryRemappedBlocks;
+    Stats::Scalar recoveryPages;
+    Stats::Scalar recoveryTime;
+
+    // Write-combining buffer hits, misses and write-backs
+    Stats::Scalar wcbWriteHits;
+    Stats::Scalar wcbWriteMisses;
+    Stats::Scalar wcbReadHits;
+    Stats::Scalar wcbEvictions;
+    Stats::Scalar wcbFlushes;
+    Stats::Formula wcbHitRate;
+
+    // ATT and PTT cache hits and misses
+    Stats::Scalar attCacheHits;
+    Stats::Scalar attCacheMisses;
+    Stats::Scalar pttCacheHits;
+    Stats::Scalar pttCacheMisses;
+    Stats::Formula attCacheHitRate;
+    Stats::Formula pttCacheHitRate;
+
+    // Bits of NVM block writes compared and actually programmed
+    Stats::Scalar nvmComparedBits;
+    Stats::Scalar nvmProgrammedBits;
+    Stats::Scalar nvmChangedWords;
+    Stats::Scalar nvmFlippedWords;
+    Stats::Scalar nvmSilentWrites;
+    Stats::Formula nvmProgrammedRatio;
+
+    /** Response latency of each translation path */
+    Stats::Histogram pathLatency[Profiler::NUM_PATHS];
+    /** Tail response latency of each translation path */
+    Stats::Value pathLatencyTail[Profiler::NUM_PATHS][NUM_TAILS];
 
     // Row hit/miss count and rate
     Stats::Scalar readRowHits;
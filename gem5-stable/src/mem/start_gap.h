@@ -0,0 +1 @@
+../../../start_gap.h
\ No newline at end of file
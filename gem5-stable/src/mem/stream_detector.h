@@ -0,0 +1 @@
+../../../stream_detector.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../trans_cache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../write_buffer.h
\ No newline at end of file
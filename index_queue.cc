@@ -45,13 +45,3 @@ void IndexQueue::PushBack(int i) {
   ++length_;
 }
 
-int IndexQueue::Accept(QueueVisitor* visitor) {
-  int num = 0, tmp;
-  for (int i = Front(); i != -EINVAL; ++num) {
-    tmp = array_[i].next;
-    visitor->Visit(i);
-    i = tmp;
-  }
-  return num;
-}
-
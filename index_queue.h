@@ -22,6 +22,8 @@ class IndexArray {
   virtual IndexNode& operator[](int i) = 0;
 };
 
+/// Any class with Visit(int) can be passed to IndexQueue::Accept;
+/// this interface is kept for visitors chosen at run time.
 class QueueVisitor {
  public:
   virtual void Visit(int i) = 0;
@@ -37,7 +39,7 @@ class IndexQueue {
   int PopFront();
   void PushBack(int i);
 
-  int Accept(QueueVisitor* visitor);
+  template <class Visitor> int Accept(Visitor* visitor);
   int length() const { return length_; }
  private:
   IndexNode& FrontNode();
@@ -79,5 +81,16 @@ inline int IndexQueue::PopFront() {
   return front;
 }
 
+template <class Visitor>
+inline int IndexQueue::Accept(Visitor* visitor) {
+  int num = 0, tmp;
+  for (int i = Front(); i != -EINVAL; ++num) {
+    tmp = array_[i].next;
+    visitor->Visit(i);
+    i = tmp;
+  }
+  return num;
+}
+
 #endif // SEXAIN_INDEX_QUEUE_H_
 
@@ -0,0 +1,112 @@
+// journal_controller.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#include "journal_controller.h"
+
+using namespace std;
+
+JournalController::JournalController(uint64_t phy_range, uint64_t dram_size,
+    int att_len, int block_bits, int page_bits, MemStore* ms, int depth,
+    int log_length, int batch) :
+    AddrTransController(phy_range, dram_size, att_len, block_bits, page_bits,
+        ms, depth),
+    log_length_(log_length ? log_length : nvm_buffer_.length()),
+    batch_(batch), log_head_(0), log_used_(0), log_writes_(0) {
+  assert(log_length_ <= nvm_buffer_.length() && batch_ > 0);
+  // Every epoch in checkpointing keeps its share of the log.
+  const int share = log_length_ / (depth - 1);
+  epoch_blocks_ = att_len;
+  while (epoch_blocks_ && LogSize(epoch_blocks_) > share) --epoch_blocks_;
+  assert(epoch_blocks_ > 0);
+}
+
+Addr JournalController::LoadAddr(Addr phy_addr, Profiler& pf) {
+  const int index = att_.Lookup(att_.ToTag(phy_addr), pf);
+  if (index != -EINVAL) {
+    att_.AddBlockRead(index);
+    const Addr mach_addr = att_.Translate(phy_addr, att_.At(index).mach_base);
+    pf.set_path(Profiler::DRAM_CACHE);
+    pf.AddLatency(mem_store_->GetReadLatency(mach_addr, true, NULL));
+    return mach_addr;
+  } else {
+    pf.set_path(Profiler::NVM_DIRECT);
+    pf.AddLatency(mem_store_->GetReadLatency(phy_addr, false, NULL));
+    return phy_addr;
+  }
+}
+
+Control JournalController::Probe(Addr phy_addr) {
+  if (!att_.Contains(att_.ToTag(phy_addr), null_pf_) &&
+      att_dirty_length() == epoch_blocks_) {
+    return ckpt_available() ? NEW_EPOCH : WAIT_CKPT;
+  }
+  return REG_WRITE;
+}
+
+Addr JournalController::StoreAddr(Addr phy_addr, int size, Profiler& pf) {
+  assert(CheckValid(phy_addr, size) && phy_addr < phy_range());
+  const Tag phy_tag = att_.ToTag(phy_addr);
+  int index = att_.Lookup(phy_tag, pf);
+  if (index == -EINVAL) {
+    assert(att_dirty_length() < epoch_blocks_);
+    const Addr mach_base = dram_buffer_.SlotAlloc(overlap_pf_);
+    if (!FullBlock(phy_addr, size)) {
+      CopyBlockInter(mach_base, att_.ToAddr(phy_tag), pf);
+    }
+    index = att_.Setup(phy_tag, mach_base, ATTEntry::DIRTY, pf);
+    pf.set_path(Profiler::NVM_ATT);
+  } else {
+    pf.set_path(Profiler::DRAM_CACHE);
+  }
+  att_.AddBlockWrite(index);
+  const Addr mach_addr = att_.Translate(phy_addr, att_.At(index).mach_base);
+  pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, true, NULL));
+  return mach_addr;
+}
+
+void JournalController::BeginCheckpointing(vector<Addr>& ckpt_blocks,
+    Profiler& pf) {
+  assert(ckpt_available());
+  vector<int> dirty;
+  DirtyCollector collector(&dirty);
+  att_.VisitQueue(ATTEntry::DIRTY, &collector);
+
+  const int size = LogSize(dirty.size());
+  assert(log_used_ + size <= log_length_);
+  log_used_ += size;
+  ckpt_logs_.push_back(size);
+
+  // Redo records, then the commit record
+  for (vector<int>::size_type i = 0; i < dirty.size(); ++i) {
+    if (i % batch_ == 0) { // descriptor
+      ckpt_blocks.push_back(LogAppend());
+      pf.AddBlockMoveInter();
+    }
+    CopyBlockInter(LogAppend(), att_.At(dirty[i]).mach_base, pf,
+        &ckpt_blocks);
+  }
+  ckpt_blocks.push_back(LogAppend());
+  pf.AddBlockMoveInter();
+
+  // In-place updates
+  for (int index : dirty) {
+    const ATTEntry& entry = att_.At(index);
+    CopyBlockInter(att_.ToAddr(entry.phy_tag), entry.mach_base, pf,
+        &ckpt_blocks);
+    dram_buffer_.FreeSlot(entry.mach_base, VersionBuffer::IN_USE,
+        overlap_pf_);
+    att_.ShiftState(index, ATTEntry::FREE, overlap_pf_);
+  }
+  pf.AddTableOp(); // assumed in parallel
+
+  ++ckpt_epochs_;
+  att_.ClearStats(pf);
+}
+
+void JournalController::FinishCheckpointing() {
+  assert(in_checkpointing() && !ckpt_logs_.empty());
+  log_used_ -= ckpt_logs_.front();
+  ckpt_logs_.pop_front();
+  --ckpt_epochs_;
+  mem_store_->OnEpochEnd();
+}
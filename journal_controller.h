@@ -0,0 +1,87 @@
+// journal_controller.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_JOURNAL_CONTROLLER_H_
+#define SEXAIN_JOURNAL_CONTROLLER_H_
+
+#include <deque>
+
+#include "addr_trans_controller.h"
+
+/// Baseline of redo logging on the same memory model as THNVM.
+/// Blocks written in an epoch are buffered in DRAM slots indexed by the ATT.
+/// At the end of the epoch, they are appended to a log in the NVM region of
+/// version buffers, in batches that each follow a descriptor block of their
+/// home addresses, and a commit record closes the log. The blocks are then
+/// written in place, and their log space is reused once that finishes.
+class JournalController : public AddrTransController {
+ public:
+  /// @log_length Log blocks in NVM, or zero for the whole region
+  /// @batch Data blocks per descriptor block
+  JournalController(uint64_t phy_range, uint64_t dram_size, int att_len,
+      int block_bits, int page_bits, MemStore* ms, int depth = 2,
+      int log_length = 0, int batch = 8);
+
+  virtual Addr LoadAddr(Addr phy_addr, Profiler& pf);
+  virtual Control Probe(Addr phy_addr);
+  virtual Addr StoreAddr(Addr phy_addr, int size, Profiler& pf);
+
+  virtual void BeginCheckpointing(std::vector<Addr>& ckpt_blocks, Profiler& pf);
+  virtual void FinishCheckpointing();
+  /// Pages are never cached in DRAM.
+  virtual void MigratePages(std::vector<Addr>& ckpt_blocks, Profiler& pf,
+      double dr = 0.33, double wr = 0.67) { }
+  virtual bool IsDRAM(Addr phy_addr, Profiler& pf) { return false; }
+
+  virtual int att_free_length() const {
+    return epoch_blocks_ - att_dirty_length();
+  }
+  /// The log already holds the addresses that the ATT would persist.
+  virtual int AddMetaBlocks(Addr meta_base, std::vector<Addr>* list) {
+    return 0;
+  }
+  /// Log blocks that a checkpoint writes besides the in-place blocks
+  virtual int meta_dirty_blocks() const {
+    return LogSize(att_dirty_length());
+  }
+
+  int log_length() const { return log_length_; }
+  int batch() const { return batch_; }
+  /// Dirty blocks that an epoch can buffer and log
+  int epoch_blocks() const { return epoch_blocks_; }
+  uint64_t log_writes() const { return log_writes_; }
+
+ private:
+  /// Log blocks for @blocks dirty blocks, with descriptors and commit record
+  int LogSize(int blocks) const {
+    return blocks + (blocks + batch_ - 1) / batch_ + 1;
+  }
+  /// Address of the next log block, wrapping around
+  Addr LogAppend();
+
+  const int log_length_;
+  const int batch_;
+  int epoch_blocks_;
+  int log_head_;
+  int log_used_; ///< By checkpoints in progress
+  std::deque<int> ckpt_logs_; ///< Log blocks per checkpoint, oldest first
+  uint64_t log_writes_; ///< Sum number of log blocks written
+
+  class DirtyCollector {
+   public:
+    DirtyCollector(std::vector<int>* list) : list_(list) { }
+    void Visit(int i) { list_->push_back(i); }
+   private:
+    std::vector<int>* list_;
+  };
+};
+
+inline Addr JournalController::LogAppend() {
+  const Addr addr = nvm_buffer_.addr_base() +
+      (Addr(log_head_) << att_.block_bits());
+  log_head_ = (log_head_ + 1) % log_length_;
+  ++log_writes_;
+  return addr;
+}
+
+#endif // SEXAIN_JOURNAL_CONTROLLER_H_
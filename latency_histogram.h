@@ -0,0 +1,87 @@
+// latency_histogram.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_LATENCY_HISTOGRAM_H_
+#define SEXAIN_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+/// Log-linear histogram for latency percentiles.
+/// Each power-of-two range is split into 2^sub_bits buckets,
+/// so any reported percentile is within 1/2^sub_bits of the real value.
+class LatencyHistogram {
+ public:
+  LatencyHistogram(int sub_bits = 5);
+
+  void Sample(uint64_t value);
+  /// @p The percentile in (0, 1], e.g., 0.999 for p999
+  uint64_t Percentile(double p) const;
+  void Reset();
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+
+ private:
+  int BucketIndex(uint64_t value) const;
+  /// The upper bound of values falling into bucket i
+  uint64_t BucketLimit(int i) const;
+
+  const int sub_bits_;
+  const uint64_t sub_mask_;
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t max_;
+};
+
+inline LatencyHistogram::LatencyHistogram(int sub_bits) :
+    sub_bits_(sub_bits), sub_mask_((uint64_t(1) << sub_bits) - 1),
+    buckets_((64 - sub_bits + 1) << sub_bits), count_(0), max_(0) {
+  assert(sub_bits > 0 && sub_bits < 16);
+}
+
+inline int LatencyHistogram::BucketIndex(uint64_t value) const {
+  if (value <= sub_mask_) return value;
+  const int msb = 63 - __builtin_clzll(value);
+  const int shift = msb - sub_bits_;
+  return ((shift + 1) << sub_bits_) | ((value >> shift) & sub_mask_);
+}
+
+inline uint64_t LatencyHistogram::BucketLimit(int i) const {
+  if (i <= (int)sub_mask_) return i;
+  const int shift = (i >> sub_bits_) - 1;
+  const uint64_t base = (sub_mask_ + 1) | (i & sub_mask_);
+  return (base << shift) + (uint64_t(1) << shift) - 1;
+}
+
+inline void LatencyHistogram::Sample(uint64_t value) {
+  ++buckets_[BucketIndex(value)];
+  ++count_;
+  if (value > max_) max_ = value;
+}
+
+inline uint64_t LatencyHistogram::Percentile(double p) const {
+  assert(p > 0 && p <= 1);
+  if (!count_) return 0;
+  uint64_t rank = (uint64_t)(p * count_ + 0.5);
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < (int)buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      uint64_t limit = BucketLimit(i);
+      return limit < max_ ? limit : max_;
+    }
+  }
+  return max_;
+}
+
+inline void LatencyHistogram::Reset() {
+  std::fill(buckets_.begin(), buckets_.end(), 0);
+  count_ = 0;
+  max_ = 0;
+}
+
+#endif // SEXAIN_LATENCY_HISTOGRAM_H_
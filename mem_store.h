@@ -9,28 +9,50 @@
 
 #include "migration_controller.h"
 
+/// Receives the ATT occupancy and epoch events that a memory publishes,
+/// e.g., a cache controller bounding the dirty blocks of its caches
+class ATTObserver {
+ public:
+  virtual ~ATTObserver() { }
+  /// @free ATT entries left for versions new to the epoch
+  /// @dirty Versions written in the epoch
+  virtual void OnATTUpdate(int free, int dirty) = 0;
+  /// After the versions of the last epoch begin checkpointing
+  virtual void OnEpochBegin() = 0;
+};
+
 class MemStore {
  public:
   virtual void MemCopy(uint64_t direct_addr, uint64_t mach_addr, int size) = 0;
   virtual void MemSwap(uint64_t direct_addr, uint64_t mach_addr, int size) = 0;
  
+  /// If a block of the machine space is all zeros
+  virtual bool IsZero(uint64_t mach_addr, int size) { return false; }
+
   virtual void OnATTOp() { }
   virtual void OnBufferOp() { }
   virtual int64_t GetReadLatency(uint64_t mach_addr, bool dram,
       const PTTEntry* page) { return -1; }
   virtual int64_t GetWriteLatency(uint64_t mach_addr, bool dram,
       const PTTEntry* page) { return -1; }
+  /// Latency of a translation cache lookup, which fetches the table entry
+  /// at @meta_addr (an offset into the ATT and PTT in memory) on a miss
+  virtual int64_t GetMetaLatency(uint64_t meta_addr, bool hit) { return -1; }
 
   virtual void OnNVMRead(uint64_t mach_addr, int size) { }
   virtual void OnNVMStore(uint64_t phy_addr, int size) { }
   virtual void OnDRAMRead(uint64_t mach_addr, int size) { }
   virtual void OnDRAMStore(uint64_t phy_addr, int size) { }
+  /// After a CLEAN version in checkpointing is moved into its home,
+  /// with the former home data moved to @mach_base
+  virtual void OnCleanFreed(uint64_t phy_addr, uint64_t mach_base) { }
 
   virtual void OnEpochEnd() { }
   virtual void OnATTWriteHit(int state) { }
   virtual void OnATTWriteMiss(int state) { }
 
   virtual void OnCacheRegister() { }
+  virtual void AddATTObserver(ATTObserver* observer) { }
   virtual void statsNVMWrites(int n = 1) { }
   virtual void statsDRAMWrites(int n = 1) { }
   virtual void ckDRAMWriteHit() { }
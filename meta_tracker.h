@@ -0,0 +1,59 @@
+// meta_tracker.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_META_TRACKER_H_
+#define SEXAIN_META_TRACKER_H_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+/// Tracks the blocks of a translation table in memory that hold entries
+/// modified since the last checkpoint, so only those are persisted.
+class MetaTracker {
+ public:
+  static const int kEntrySize = 8; ///< Bytes of an ATT or PTT entry
+
+  MetaTracker(int num_entries, int block_bits);
+
+  void Mark(int index);
+  /// Adds the dirty blocks to the list as offsets from @base,
+  /// and returns their number
+  int Flush(uint64_t base, std::vector<uint64_t>* list);
+
+  int num_dirty() const { return dirty_list_.size(); }
+  /// Bytes of the table in memory, in whole blocks
+  uint64_t size() const { return uint64_t(dirty_.size()) << block_bits_; }
+
+ private:
+  const int block_bits_;
+  const int entries_per_block_;
+  std::vector<bool> dirty_; ///< Per block
+  std::vector<int> dirty_list_;
+};
+
+inline MetaTracker::MetaTracker(int num_entries, int block_bits) :
+    block_bits_(block_bits), entries_per_block_((1 << block_bits) / kEntrySize),
+    dirty_((num_entries + entries_per_block_ - 1) / entries_per_block_) {
+  assert(entries_per_block_ > 0);
+}
+
+inline void MetaTracker::Mark(int index) {
+  const int block = index / entries_per_block_;
+  assert(block >= 0 && block < int(dirty_.size()));
+  if (dirty_[block]) return;
+  dirty_[block] = true;
+  dirty_list_.push_back(block);
+}
+
+inline int MetaTracker::Flush(uint64_t base, std::vector<uint64_t>* list) {
+  const int num = dirty_list_.size();
+  for (int block : dirty_list_) {
+    dirty_[block] = false;
+    list->push_back(base + (uint64_t(block) << block_bits_));
+  }
+  dirty_list_.clear();
+  return num;
+}
+
+#endif // SEXAIN_META_TRACKER_H_
@@ -98,22 +98,52 @@ void MigrationController::AddToBlockList(Addr page, vector<Addr>* list) {
   }
 }
 
-void MigrationController::Clear(Profiler& pf, vector<Addr>* ckpt_blocks) {
-  pf.AddPageMoveInter(dirty_entries_); // epoch write-backs
+int MigrationController::AddToBlockList(Addr page, uint64_t blocks,
+    vector<Addr>* list) {
+  assert((page & page_mask_) == 0 && list);
+  const int group = 1 << dirty_shift_;
+  int num = 0;
+  for (int i = 0; i < page_blocks_; i += group) {
+    if (!(blocks >> (i >> dirty_shift_) & 1)) continue;
+    for (int j = i; j < i + group; ++j) {
+      list->push_back(page + ((Addr)j << block_bits_));
+    }
+    num += group;
+  }
+  return num;
+}
+
+void MigrationController::Clear(Profiler& pf) {
+  assert(rewritten_entries_ == 0);
+  write_backs_.push_back(vector<Addr>());
   for (PTTEntryIterator it = entries_.begin(); it != entries_.end(); ++it) {
-    it->second.epoch_reads = 0;
-    it->second.epoch_writes = 0;
-    if (it->second.state == PTTEntry::DIRTY_DIRECT) {
-      ShiftState(it, PTTEntry::CLEAN_DIRECT, pf);
-      --dirty_entries_;
-      AddToBlockList(it->second.mach_base, ckpt_blocks);
-    } else if (it->second.state == PTTEntry::DIRTY_STATIC) {
-      ShiftState(it, PTTEntry::CLEAN_STATIC, pf);
+    PTTEntry& entry = it->second;
+    entry.epoch_reads = 0;
+    entry.epoch_writes = 0;
+    if (entry.state == PTTEntry::DIRTY_DIRECT ||
+        entry.state == PTTEntry::DIRTY_STATIC) {
+      ShiftState(it, entry.state == PTTEntry::DIRTY_DIRECT ?
+          PTTEntry::CLEAN_DIRECT : PTTEntry::CLEAN_STATIC, pf);
       --dirty_entries_;
-      AddToBlockList(it->second.mach_base, ckpt_blocks);
+      // The copy written back is in sync, and the other one misses
+      // the blocks written in this epoch.
+      entry.stale_blocks = entry.dirty_blocks;
+      entry.written_back = true;
+      write_backs_.back().push_back(it->first);
     }
+    entry.dirty_blocks = 0;
   }
   assert(dirty_entries_ == 0);
+  // Checkpoints before this one keep the home of a page moved in as
+  // static, which its first write-back overwrites.
+  for (Addr page_addr : new_entries_) {
+    PTTEntryIterator it = entries_.find(page_addr);
+    if (it == entries_.end() || it->second.written_back ||
+        it->second.state != PTTEntry::CLEAN_STATIC) continue;
+    it->second.written_back = true;
+    write_backs_.back().push_back(page_addr);
+  }
+  new_entries_.clear();
 
   nvm_pages_.clear();
   dram_heap_.clear();
@@ -121,3 +151,17 @@ void MigrationController::Clear(Profiler& pf, vector<Addr>* ckpt_blocks) {
   dram_heap_filled_ = false;
   nvm_heap_filled_ = false;
 }
+
+void MigrationController::FinishWriteBack() {
+  assert(!write_backs_.empty());
+  for (Addr page_addr : write_backs_.front()) {
+    PTTEntryIterator it = entries_.find(page_addr);
+    if (it == entries_.end() || !it->second.written_back) continue;
+    it->second.written_back = false;
+    if (it->second.state == PTTEntry::DIRTY_DIRECT ||
+        it->second.state == PTTEntry::DIRTY_STATIC) {
+      --rewritten_entries_;
+    }
+  }
+  write_backs_.pop_front();
+}
@@ -6,11 +6,13 @@
 
 #include <cassert>
 #include <vector>
+#include <deque>
 #include <unordered_map>
 #include <set>
 #include <algorithm>
 
 #include "addr_trans_table.h"
+#include "meta_tracker.h"
 #include "profiler.h"
 
 struct PTTEntry {
@@ -26,10 +28,18 @@ struct PTTEntry {
   int epoch_writes;
   int index;
   Addr mach_base;
+  uint64_t dirty_blocks; ///< Bitmap of blocks written in the epoch
+  /// Bitmap of blocks written in the last dirty epoch, which the
+  /// alternate copy (home or backup) of a DRAM page still misses
+  uint64_t stale_blocks;
+  /// Written back, or moved in as static, by a checkpoint in flight, so
+  /// that the alternate copy is still kept by the last finished checkpoint
+  bool written_back;
 
   static const char* state_strings[];
 
-  PTTEntry() : epoch_reads(0), epoch_writes(0), index(-EINVAL) { }
+  PTTEntry() : epoch_reads(0), epoch_writes(0), index(-EINVAL),
+      dirty_blocks(0), stale_blocks(~0ull), written_back(false) { }
 
   const char* StateString() const {
     return state_strings[state];
@@ -70,6 +80,8 @@ class MigrationController {
   Addr Translate(Addr phy_addr, Addr page_base) const;
   void AddDRAMPageRead(Addr phy_addr);
   void AddDRAMPageWrite(Addr phy_addr);
+  /// Counts NVM writes whose ATT entries leave before the end of an epoch
+  void AddNVMPageWrites(int writes) { total_nvm_writes_ += writes; }
 
   /// Calculate statistics over the blocks from ATT
   void InputBlocks(const std::vector<ATTEntry>& blocks);
@@ -77,10 +89,24 @@ class MigrationController {
   bool ExtractNVMPage(NVMPageStats& stats, Profiler& profiler);
   /// Next DRAM page with increasing dirty ratio
   bool ExtractDRAMPage(DRAMPageStats& stats, Profiler& profiler);
-  /// Clear up all entries, heaps, epoch statistics, etc.
-  void Clear(Profiler& profiler, std::vector<Addr>* ckpt_blocks);
+  /// Clear up all entries, heaps, epoch statistics, etc., after the
+  /// dirty pages are written back
+  void Clear(Profiler& profiler);
+  /// Called when the oldest checkpoint in flight finishes
+  void FinishWriteBack();
+  /// Dirty pages whose write-back would overwrite the copy kept by the
+  /// last finished checkpoint, so that no other epoch may begin
+  /// checkpointing until the earlier write-back finishes
+  int num_rewritten_entries() const { return rewritten_entries_; }
 
   void AddToBlockList(Addr page, std::vector<Addr>* list);
+  /// Adds the blocks marked in a dirty bitmap and returns their number
+  int AddToBlockList(Addr page, uint64_t blocks, std::vector<Addr>* list);
+  /// Adds the table blocks modified since the last call to the list
+  int FlushMeta(Addr base, std::vector<Addr>* list) {
+    return meta_.Flush(base, list);
+  }
+  const MetaTracker& meta() const { return meta_; }
 
   int page_bits() const { return page_bits_; }
   int page_size() const { return 1 << page_bits_; }
@@ -91,8 +117,21 @@ class MigrationController {
   int ptt_length() const { return ptt_length_; }
   int ptt_capacity() const { return ptt_capacity_; }
   uint64_t dram_capacity() const { return ptt_capacity_ << page_bits_; }
+  /// Bytes of the NVM backup region that holds static copies of pages
+  uint64_t backup_size() const { return dram_capacity() << 1; }
+  /// Offset of the static copy of a page in the backup region. Each entry
+  /// has two slots and turns to the other one when freed, so that a page
+  /// moved in never overwrites the copy that the last checkpoint keeps of
+  /// the page moved out.
+  uint64_t BackupOffset(const PTTEntry& entry) const {
+    return uint64_t(2 * entry.index + backup_sides_[entry.index]) <<
+        page_bits_;
+  }
   int num_entries() const { return entries_.size(); }
   int num_dirty_entries() const { return dirty_entries_; }
+  const std::unordered_map<Addr, PTTEntry>& entries() const {
+    return entries_;
+  }
 
   uint64_t total_nvm_writes() const { return total_nvm_writes_; }
   uint64_t total_dram_writes() const { return total_dram_writes_; }
@@ -118,10 +157,14 @@ class MigrationController {
   const int page_bits_;
   const Addr page_mask_;
   const int page_blocks_;
+  const int dirty_shift_; ///< Log2 of blocks per bit of dirty bitmaps
   const int ptt_length_;
   const int ptt_capacity_;
 
+  Profiler overlap_pf_; ///< Sink of operations overlapped with others
+
   int dirty_entries_; ///< Number of dirty pages each epoch
+  int rewritten_entries_;
 
   uint64_t total_nvm_writes_; ///< Sum number of NVM writes, for verification
   uint64_t total_dram_writes_; ///< Sum number of DRAM writes, for verification
@@ -129,7 +172,11 @@ class MigrationController {
   uint64_t dirty_nvm_pages_; ///< Sum number of dirty NVM pages
   uint64_t dirty_dram_pages_; ///< Sum number of dirty DRAM pages
 
+  MetaTracker meta_;
   std::vector<int> free_slots_;
+  std::vector<bool> backup_sides_;
+  std::deque<std::vector<Addr>> write_backs_; ///< Of checkpoints in flight
+  std::vector<Addr> new_entries_; ///< Set up since the last Clear
   std::unordered_map<Addr, PTTEntry> entries_;
   std::unordered_map<Addr, NVMPage> nvm_pages_;
   std::vector<DRAMPageStats> dram_heap_;
@@ -144,10 +191,13 @@ inline MigrationController::MigrationController(
     block_bits_(block_bits), block_mask_((1 << block_bits) - 1),
     page_bits_(page_bits), page_mask_((1 << page_bits) - 1),
     page_blocks_(1 << (page_bits - block_bits)),
+    dirty_shift_(std::max(page_bits - block_bits - 6, 0)),
     ptt_length_(ptt_length), ptt_capacity_(ptt_length + (ptt_length >> 4)),
-    dirty_entries_(0),
+    overlap_pf_(block_bits, page_bits),
+    dirty_entries_(0), rewritten_entries_(0),
     total_nvm_writes_(0), total_dram_writes_(0),
     dirty_nvm_blocks_(0), dirty_nvm_pages_(0), dirty_dram_pages_(0),
+    meta_(ptt_capacity_, block_bits), backup_sides_(ptt_capacity_),
     dram_heap_filled_(false), nvm_heap_filled_(false) {
 
   for (int i = 0; i < ptt_capacity_; ++i) {
@@ -178,6 +228,8 @@ inline void MigrationController::AddDRAMPageWrite(Addr phy_addr) {
   PTTEntryIterator it = entries_.find(PageAlign(phy_addr));
   assert(it != entries_.end());
   ++it->second.epoch_writes;
+  it->second.dirty_blocks |=
+      1ull << (((phy_addr & page_mask_) >> block_bits_) >> dirty_shift_);
 }
 
 inline void MigrationController::ShiftState(PTTEntryIterator it,
@@ -185,7 +237,9 @@ inline void MigrationController::ShiftState(PTTEntryIterator it,
   it->second.state = state;
   if (state == PTTEntry::DIRTY_DIRECT || state == PTTEntry::DIRTY_STATIC) {
     ++dirty_entries_;
+    if (it->second.written_back) ++rewritten_entries_;
   }
+  meta_.Mark(it->second.index);
   pf.AddTableOp();
 }
 
@@ -199,14 +253,17 @@ inline void MigrationController::ShiftState(Addr page_addr,
 
 inline void MigrationController::Free(Addr page_addr, Profiler& pf) {
   assert(PageAlign(page_addr) == page_addr);
-  const PTTEntry entry = LookupPage(page_addr, Profiler::Overlap);
+  const PTTEntry entry = LookupPage(page_addr, overlap_pf_);
   assert(entry.index >= 0 && entry.index < ptt_capacity_);
+  assert(!entry.written_back);
   if (entry.state == PTTEntry::DIRTY_DIRECT ||
       entry.state == PTTEntry::DIRTY_STATIC) {
     --dirty_entries_;
   }
   entries_.erase(entry.mach_base);
   free_slots_.push_back(entry.index);
+  backup_sides_[entry.index] = !backup_sides_[entry.index];
+  meta_.Mark(entry.index);
   assert(free_slots_.size() + entries_.size() == ptt_capacity_);
   pf.AddTableOp();
 }
@@ -214,7 +271,7 @@ inline void MigrationController::Free(Addr page_addr, Profiler& pf) {
 inline void MigrationController::Setup(
     Addr page_addr, PTTEntry::State state, Profiler& pf) {
   assert(PageAlign(page_addr) == page_addr);
-  assert(!Contains(page_addr, Profiler::Overlap));
+  assert(!Contains(page_addr, overlap_pf_));
 
   PTTEntry& entry = entries_[page_addr];
   entry.index = free_slots_.back();
@@ -224,7 +281,12 @@ inline void MigrationController::Setup(
   if (state == PTTEntry::DIRTY_DIRECT || state == PTTEntry::DIRTY_STATIC) {
     ++dirty_entries_;
   }
+  entry.dirty_blocks = 0;
+  entry.stale_blocks = ~0ull; // neither copy is known to be in sync
+  entry.written_back = false;
   entry.mach_base = page_addr; // simulate direct/static page allocation
+  new_entries_.push_back(page_addr);
+  meta_.Mark(entry.index);
   assert(entries_.size() <= ptt_capacity_);
   pf.AddTableOp();
 }
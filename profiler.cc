@@ -3,6 +3,8 @@
 
 #include "profiler.h"
 
-Profiler Profiler::Null(0, 0);
-Profiler Profiler::Overlap(0, 0);
+const char* ProfilerBase::path_strings[] = {
+    "nvm_direct", "nvm_att", "att_evict", "dram_cache", "dram_loan",
+    "ckpt_stall"
+};
 
@@ -7,10 +7,55 @@
 #include <cstdint>
 #include <cassert>
 
-class Profiler {
+// Instrumentation levels of Profiler, selected at build time
+#define PROFILE_NONE 0 ///< Compiled out
+#define PROFILE_COUNTERS 1 ///< Counters of operations and bus traffic only
+#define PROFILE_FULL 2 ///< Counters plus latency accounting
+
+#ifndef PROFILE_LEVEL
+#define PROFILE_LEVEL PROFILE_FULL
+#endif
+
+struct FullProfiling {
+  static const bool kCounters = true;
+  static const bool kLatency = true;
+};
+
+struct CounterProfiling {
+  static const bool kCounters = true;
+  static const bool kLatency = false;
+};
+
+struct NoProfiling {
+  static const bool kCounters = false;
+  static const bool kLatency = false;
+};
+
+class ProfilerBase {
  public:
-  Profiler(int block_bits, int page_bits);
-  Profiler(const Profiler& p);
+  enum Path { ///< Translation path that serves an access
+    NVM_DIRECT = 0, ///< NVM home without ATT entry
+    NVM_ATT, ///< NVM via ATT, e.g., DIRTY/HIDDEN
+    ATT_EVICT, ///< ATT miss that evicts a CLEAN/LOAN entry
+    DRAM_CACHE, ///< DRAM cache hit
+    DRAM_LOAN, ///< DRAM cache in checkpointing with LOAN setup
+    CKPT_STALL, ///< Write stalled by WAIT_CKPT
+    NUM_PATHS,
+  };
+
+  static const char* path_strings[];
+};
+
+/// The policy decides at compile time which accounting is done,
+/// so that a disabled counter costs neither a branch nor a store.
+template <class Policy>
+class BasicProfiler : public ProfilerBase {
+ public:
+  static const bool kCounters = Policy::kCounters;
+  static const bool kLatency = Policy::kLatency;
+
+  BasicProfiler(int block_bits, int page_bits);
+  BasicProfiler(const BasicProfiler& p);
 
   void AddTableOp(int num = 1);
   void AddBufferOp(int num = 1);
@@ -32,8 +77,8 @@ class Profiler {
 
   void set_op_latency(int64_t lat) { op_latency_ = lat; }
 
-  static Profiler Null;
-  static Profiler Overlap;
+  Path path() const { return path_; }
+  void set_path(Path path) { if (kCounters) path_ = path; }
 
  private:
   const int block_bits_;
@@ -48,69 +93,102 @@ class Profiler {
 
   int64_t op_latency_;
   bool ignore_latency_;
+  Path path_;
 };
 
-inline Profiler::Profiler(int block_bits, int page_bits) :
+#if PROFILE_LEVEL == PROFILE_FULL
+typedef BasicProfiler<FullProfiling> Profiler;
+#elif PROFILE_LEVEL == PROFILE_COUNTERS
+typedef BasicProfiler<CounterProfiling> Profiler;
+#elif PROFILE_LEVEL == PROFILE_NONE
+typedef BasicProfiler<NoProfiling> Profiler;
+#else
+#error "Unknown PROFILE_LEVEL"
+#endif
+
+template <class Policy>
+inline BasicProfiler<Policy>::BasicProfiler(int block_bits, int page_bits) :
     block_bits_(block_bits), page_bits_(page_bits),
     num_table_ops_(0), num_buffer_ops_(0), latency_(0),
     bytes_intra_channel_(0), bytes_inter_channel_(0) {
   op_latency_ = -1;
   ignore_latency_ = false;
+  path_ = NVM_DIRECT;
 }
 
-inline Profiler::Profiler(const Profiler& p) :
-    Profiler(p.block_bits_, p.page_bits_) {
+template <class Policy>
+inline BasicProfiler<Policy>::BasicProfiler(const BasicProfiler& p) :
+    BasicProfiler(p.block_bits_, p.page_bits_) {
   op_latency_ = p.op_latency_;
 }
 
-inline void Profiler::set_ignore_latency() {
+template <class Policy>
+inline void BasicProfiler<Policy>::set_ignore_latency() {
+  if (!kCounters) return; // also excludes ops from the counters
   assert(!ignore_latency_);
   ignore_latency_ = true;
 }
 
-inline void Profiler::clear_ignore_latency() {
+template <class Policy>
+inline void BasicProfiler<Policy>::clear_ignore_latency() {
+  if (!kCounters) return;
   assert(ignore_latency_);
   ignore_latency_ = false;
 }
 
-inline void Profiler::AddTableOp(int num) {
-  if (ignore_latency_) return;
+template <class Policy>
+inline void BasicProfiler<Policy>::AddTableOp(int num) {
+  if (!kCounters || ignore_latency_) return;
   num_table_ops_ += num;
 }
 
-inline void Profiler::AddBufferOp(int num) {
-  if (ignore_latency_) return;
+template <class Policy>
+inline void BasicProfiler<Policy>::AddBufferOp(int num) {
+  if (!kCounters || ignore_latency_) return;
   num_buffer_ops_ += num;
 }
 
-inline void Profiler::AddLatency(int lat) {
+template <class Policy>
+inline void BasicProfiler<Policy>::AddLatency(int lat) {
+  if (!kLatency) return;
   assert(lat > 0 && !ignore_latency_);
   latency_ += lat;
 }
 
-inline void Profiler::AddBlockMoveIntra(int num) {
+template <class Policy>
+inline void BasicProfiler<Policy>::AddBlockMoveIntra(int num) {
+  if (!kCounters) return;
   bytes_intra_channel_ += num << block_bits_;
 }
 
-inline void Profiler::AddBlockMoveInter(int num) {
+template <class Policy>
+inline void BasicProfiler<Policy>::AddBlockMoveInter(int num) {
+  if (!kCounters) return;
   bytes_inter_channel_ += num << block_bits_;
 }
 
-inline void Profiler::AddPageMoveIntra(int num) {
+template <class Policy>
+inline void BasicProfiler<Policy>::AddPageMoveIntra(int num) {
+  if (!kCounters) return;
   bytes_intra_channel_ += num << page_bits_;
 }
 
-inline void Profiler::AddPageMoveInter(int num) {
+template <class Policy>
+inline void BasicProfiler<Policy>::AddPageMoveInter(int num) {
+  if (!kCounters) return;
   bytes_inter_channel_ += num << page_bits_;
 }
 
-inline uint64_t Profiler::SumLatency() {
+template <class Policy>
+inline uint64_t BasicProfiler<Policy>::SumLatency() {
+  if (!kLatency) return 0;
   assert(op_latency_ >= 0);
   assert(!ignore_latency_);
   return latency_ + op_latency_ * (num_table_ops_ + num_buffer_ops_);
 }
 
-inline uint64_t Profiler::SumBusUtil(bool exc_intra) {
+template <class Policy>
+inline uint64_t BasicProfiler<Policy>::SumBusUtil(bool exc_intra) {
   return (exc_intra ? 0 : bytes_intra_channel_) + bytes_inter_channel_;
 }
 
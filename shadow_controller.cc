@@ -0,0 +1,121 @@
+// shadow_controller.cc
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#include "shadow_controller.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ShadowController::ShadowController(uint64_t phy_range, uint64_t dram_size,
+    int att_len, int block_bits, int page_bits, MemStore* ms, int depth) :
+    AddrTransController(phy_range, dram_size, att_len, block_bits, page_bits,
+        ms, depth),
+    table_meta_(phy_range >> page_bits, block_bits), cow_pages_(0) {
+  assert((phy_range & (page_size() - 1)) == 0);
+  // As much DRAM as the ATT versions of THNVM take
+  epoch_pages_ = dram_buffer_.Size() / page_size();
+  assert(epoch_pages_ > 0);
+  for (int i = epoch_pages_ - 1; i >= 0; --i) {
+    free_slots_.push_back(dram_buffer_.addr_base() + Addr(i) * page_size());
+  }
+  // Epochs in checkpointing hold the pages they free.
+  const int nvm_pages = nvm_buffer_.Size() / page_size();
+  assert(nvm_pages >= epoch_pages_ * (depth - 1));
+  for (int i = nvm_pages - 1; i >= 0; --i) {
+    free_pages_.push_back(nvm_buffer_.addr_base() + Addr(i) * page_size());
+  }
+}
+
+Addr ShadowController::LoadAddr(Addr phy_addr, Profiler& pf) {
+  const Addr page = ToPage(phy_addr);
+  pf.AddTableOp();
+  unordered_map<Addr, Addr>::iterator it = shadows_.find(page);
+  if (it != shadows_.end()) {
+    const Addr mach_addr = it->second + (phy_addr - page);
+    pf.set_path(Profiler::DRAM_CACHE);
+    pf.AddLatency(mem_store_->GetReadLatency(mach_addr, true, NULL));
+    return mach_addr;
+  } else {
+    const Addr mach_addr = Location(page) + (phy_addr - page);
+    pf.set_path(Profiler::NVM_DIRECT);
+    pf.AddLatency(mem_store_->GetReadLatency(mach_addr, false, NULL));
+    return mach_addr;
+  }
+}
+
+Control ShadowController::Probe(Addr phy_addr) {
+  if (!shadows_.count(ToPage(phy_addr)) &&
+      int(shadows_.size()) == epoch_pages_) {
+    return ckpt_available() ? NEW_EPOCH : WAIT_CKPT;
+  }
+  return REG_WRITE;
+}
+
+Addr ShadowController::StoreAddr(Addr phy_addr, int size, Profiler& pf) {
+  assert(CheckValid(phy_addr, size) && phy_addr < phy_range());
+  const Addr page = ToPage(phy_addr);
+  pf.AddTableOp();
+  unordered_map<Addr, Addr>::iterator it = shadows_.find(page);
+  if (it == shadows_.end()) { // copy-on-write
+    assert(!free_slots_.empty());
+    const Addr dram_base = free_slots_.back();
+    free_slots_.pop_back();
+    mem_store_->MemCopy(dram_base, Location(page), page_size());
+    pf.AddPageMoveInter();
+    it = shadows_.insert(make_pair(page, dram_base)).first;
+    table_meta_.Mark(page / page_size());
+    ++cow_pages_;
+    pf.set_path(Profiler::DRAM_LOAN);
+  } else {
+    pf.set_path(Profiler::DRAM_CACHE);
+  }
+  const Addr mach_addr = it->second + (phy_addr - page);
+  pf.AddLatency(mem_store_->GetWriteLatency(mach_addr, true, NULL));
+  return mach_addr;
+}
+
+void ShadowController::BeginCheckpointing(vector<Addr>& ckpt_blocks,
+    Profiler& pf) {
+  assert(ckpt_available() && free_pages_.size() >= shadows_.size());
+  // Ascending, for row buffer locality
+  vector<pair<Addr, Addr>> pages(shadows_.begin(), shadows_.end());
+  sort(pages.begin(), pages.end());
+
+  ckpt_frees_.push_back(vector<Addr>());
+  for (const pair<Addr, Addr>& shadow : pages) {
+    const Addr nvm_base = free_pages_.back();
+    free_pages_.pop_back();
+    mem_store_->MemCopy(nvm_base, shadow.second, page_size());
+    pf.AddPageMoveInter();
+    for (int i = 0; i < page_blocks(); ++i) {
+      ckpt_blocks.push_back(nvm_base + i * block_size());
+    }
+    ckpt_frees_.back().push_back(Location(shadow.first));
+    if (nvm_base == shadow.first) {
+      table_.erase(shadow.first);
+    } else {
+      table_[shadow.first] = nvm_base;
+    }
+    free_slots_.push_back(shadow.second);
+  }
+  shadows_.clear();
+  pf.AddTableOp(); // assumed in parallel
+
+  ++ckpt_epochs_;
+}
+
+void ShadowController::FinishCheckpointing() {
+  assert(in_checkpointing() && !ckpt_frees_.empty());
+  vector<Addr>& pages = ckpt_frees_.front();
+  free_pages_.insert(free_pages_.end(), pages.begin(), pages.end());
+  ckpt_frees_.pop_front();
+  --ckpt_epochs_;
+  mem_store_->OnEpochEnd();
+}
+
+int ShadowController::AddMetaBlocks(Addr meta_base, vector<Addr>* list) {
+  int num = table_meta_.Flush(meta_base, list);
+  list->push_back(meta_base + table_meta_.size()); // switched last
+  return num + 1;
+}
@@ -0,0 +1,73 @@
+// shadow_controller.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_SHADOW_CONTROLLER_H_
+#define SEXAIN_SHADOW_CONTROLLER_H_
+
+#include <deque>
+#include <unordered_map>
+
+#include "addr_trans_controller.h"
+#include "meta_tracker.h"
+
+/// Baseline of page-level shadow paging on the same memory model as THNVM.
+/// The first write to a page in an epoch copies it to a DRAM slot, where
+/// the epoch keeps writing it. At the end of the epoch, the pages are
+/// written to free NVM pages rather than in place, and the page table is
+/// switched atomically by its modified blocks and a root block. The former
+/// NVM pages are freed once the checkpoint finishes. Free pages come from
+/// the NVM region of version buffers and the pages freed since.
+class ShadowController : public AddrTransController {
+ public:
+  ShadowController(uint64_t phy_range, uint64_t dram_size, int att_len,
+      int block_bits, int page_bits, MemStore* ms, int depth = 2);
+
+  virtual Addr LoadAddr(Addr phy_addr, Profiler& pf);
+  virtual Control Probe(Addr phy_addr);
+  virtual Addr StoreAddr(Addr phy_addr, int size, Profiler& pf);
+
+  virtual void BeginCheckpointing(std::vector<Addr>& ckpt_blocks, Profiler& pf);
+  virtual void FinishCheckpointing();
+  /// Pages are only cached in DRAM while written in an epoch.
+  virtual void MigratePages(std::vector<Addr>& ckpt_blocks, Profiler& pf,
+      double dr = 0.33, double wr = 0.67) { }
+  virtual bool IsDRAM(Addr phy_addr, Profiler& pf) { return false; }
+
+  /// In blocks, at most a page each
+  virtual int att_free_length() const {
+    return (epoch_pages_ - shadows_.size()) * page_blocks();
+  }
+  /// Adds the modified page table blocks, then the root block
+  virtual int AddMetaBlocks(Addr meta_base, std::vector<Addr>* list);
+  /// Shadow page and page table blocks that a checkpoint writes
+  virtual int meta_dirty_blocks() const {
+    return shadows_.size() * page_blocks() + table_meta_.num_dirty() + 1;
+  }
+
+  /// Pages that an epoch can write
+  int epoch_pages() const { return epoch_pages_; }
+  int page_blocks() const { return page_size() / block_size(); }
+  /// Sum number of pages copied on their first writes in epochs
+  uint64_t cow_pages() const { return cow_pages_; }
+
+ private:
+  Addr ToPage(Addr phy_addr) const { return phy_addr & ~Addr(page_size() - 1); }
+  /// NVM page as of the last checkpoint begun
+  Addr Location(Addr page) const;
+
+  int epoch_pages_;
+  std::unordered_map<Addr, Addr> table_; ///< Pages not in their homes
+  std::unordered_map<Addr, Addr> shadows_; ///< DRAM copies in the epoch
+  std::vector<Addr> free_slots_; ///< DRAM
+  std::vector<Addr> free_pages_; ///< NVM
+  std::deque<std::vector<Addr>> ckpt_frees_; ///< Per checkpoint in progress
+  MetaTracker table_meta_;
+  uint64_t cow_pages_;
+};
+
+inline Addr ShadowController::Location(Addr page) const {
+  std::unordered_map<Addr, Addr>::const_iterator it = table_.find(page);
+  return it == table_.end() ? page : it->second;
+}
+
+#endif // SEXAIN_SHADOW_CONTROLLER_H_
@@ -0,0 +1,60 @@
+// start_gap.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_START_GAP_H_
+#define SEXAIN_START_GAP_H_
+
+#include <cstdint>
+#include <cassert>
+
+/// Start-Gap wear leveling (Qureshi et al., MICRO'09).
+/// Logical lines [0, N) map to physical lines [0, N], one of which is the
+/// gap. Every interval writes, the line next to the gap moves into it.
+class StartGap {
+ public:
+  StartGap(uint64_t num_lines, int interval);
+
+  uint64_t Map(uint64_t line) const;
+  /// Counts a write to the region.
+  /// @return true if the gap moves, and @moved takes the physical line
+  /// written by the move
+  bool OnWrite(uint64_t* moved);
+
+  uint64_t num_lines() const { return num_lines_; }
+  uint64_t start() const { return start_; }
+  uint64_t gap() const { return gap_; }
+
+ private:
+  const uint64_t num_lines_;
+  const int interval_;
+  uint64_t start_;
+  uint64_t gap_;
+  int writes_;
+};
+
+inline StartGap::StartGap(uint64_t num_lines, int interval) :
+    num_lines_(num_lines), interval_(interval),
+    start_(0), gap_(num_lines), writes_(0) {
+  assert(num_lines_ && interval_ > 0);
+}
+
+inline uint64_t StartGap::Map(uint64_t line) const {
+  assert(line < num_lines_);
+  uint64_t pa = (line + start_) % num_lines_;
+  return pa >= gap_ ? pa + 1 : pa;
+}
+
+inline bool StartGap::OnWrite(uint64_t* moved) {
+  if (++writes_ < interval_) return false;
+  writes_ = 0;
+  *moved = gap_;
+  if (gap_ == 0) { // the last line wraps around to the top
+    gap_ = num_lines_;
+    start_ = (start_ + 1) % num_lines_;
+  } else {
+    --gap_;
+  }
+  return true;
+}
+
+#endif // SEXAIN_START_GAP_H_
@@ -0,0 +1,74 @@
+// stream_detector.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_STREAM_DETECTOR_H_
+#define SEXAIN_STREAM_DETECTOR_H_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+/// Detects sequential or strided block writes within pages,
+/// tracking a few recently written pages with LRU replacement.
+class StreamDetector {
+ public:
+  StreamDetector(int block_bits, int page_bits, int length = 16);
+
+  /// Records a block write.
+  /// @stride Set to the stride in blocks, if not null, once detected
+  /// @return true once the page sees @threshold blocks of one stride
+  bool Write(uint64_t phy_addr, int threshold, int* stride = NULL);
+
+ private:
+  struct Stream {
+    uint64_t page; ///< Page number, or -1 if unused
+    int last_block; ///< Block offset in page of the last write
+    int stride; ///< In blocks, zero if unknown
+    int count; ///< Number of blocks in the stream so far
+    uint64_t last_use;
+  };
+
+  const int block_bits_;
+  const int page_bits_;
+  std::vector<Stream> streams_;
+  uint64_t clock_;
+};
+
+inline StreamDetector::StreamDetector(int block_bits, int page_bits,
+    int length) : block_bits_(block_bits), page_bits_(page_bits),
+    streams_(length, Stream{uint64_t(-1), 0, 0, 0, 0}), clock_(0) {
+  assert(length > 0 && page_bits_ > block_bits_);
+}
+
+inline bool StreamDetector::Write(uint64_t phy_addr, int threshold,
+    int* stride) {
+  const uint64_t page = phy_addr >> page_bits_;
+  const int block = (phy_addr >> block_bits_) &
+      ((1 << (page_bits_ - block_bits_)) - 1);
+  Stream* victim = &streams_[0];
+  for (Stream& s : streams_) {
+    if (s.page != page) {
+      if (s.last_use < victim->last_use) victim = &s;
+      continue;
+    }
+    s.last_use = ++clock_;
+    const int step = block - s.last_block;
+    if (step == 0) return false; // rewrites neither extend nor break it
+    if (step == s.stride) {
+      ++s.count;
+    } else {
+      s.stride = step;
+      s.count = 2;
+    }
+    s.last_block = block;
+    if (s.count < threshold) return false;
+    if (stride) *stride = s.stride;
+    s.page = -1;
+    s.last_use = 0;
+    return true;
+  }
+  *victim = Stream{page, block, 0, 1, ++clock_};
+  return threshold <= 1;
+}
+
+#endif // SEXAIN_STREAM_DETECTOR_H_
@@ -0,0 +1,66 @@
+// trans_cache.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_TRANS_CACHE_H_
+#define SEXAIN_TRANS_CACHE_H_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+/// Set-associative cache of translation table entries with LRU
+/// replacement, modeling the controller SRAM in front of a table in DRAM.
+/// It keeps keys only, e.g., block tags or page numbers.
+class TransCache {
+ public:
+  TransCache() : num_sets_(0), assoc_(0), clock_(0), hits_(0), misses_(0) { }
+
+  /// @entries Zero disables the cache, i.e., the whole table is in SRAM
+  void Resize(int entries, int assoc);
+  /// Returns true on a hit, otherwise fills the key in
+  bool Access(uint64_t key);
+
+  bool enabled() const { return num_sets_; }
+  int entries() const { return num_sets_ * assoc_; }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  struct Way {
+    uint64_t key;
+    uint64_t last_use; ///< Zero if invalid
+  };
+
+  int num_sets_;
+  int assoc_;
+  std::vector<Way> ways_; ///< Sets of assoc_ ways in a row
+  uint64_t clock_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+inline void TransCache::Resize(int entries, int assoc) {
+  assert(entries >= 0 && assoc > 0 && entries % assoc == 0);
+  num_sets_ = entries / assoc;
+  assoc_ = assoc;
+  ways_.assign(entries, Way{0, 0});
+}
+
+inline bool TransCache::Access(uint64_t key) {
+  assert(enabled());
+  Way* set = &ways_[(key % num_sets_) * assoc_];
+  Way* victim = set;
+  for (int i = 0; i < assoc_; ++i) {
+    if (set[i].last_use && set[i].key == key) {
+      set[i].last_use = ++clock_;
+      ++hits_;
+      return true;
+    }
+    if (set[i].last_use < victim->last_use) victim = set + i;
+  }
+  *victim = Way{key, ++clock_};
+  ++misses_;
+  return false;
+}
+
+#endif // SEXAIN_TRANS_CACHE_H_
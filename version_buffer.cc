@@ -6,50 +6,55 @@
 using namespace std;
 
 uint64_t VersionBuffer::SlotAlloc(Profiler& pf) {
-  assert(!sets_[FREE].empty());
-  int i = *sets_[FREE].begin();
-  sets_[FREE].erase(sets_[FREE].begin());
-  sets_[IN_USE].insert(i);
+  assert(!Set(FREE).empty());
+  set<int>::iterator it = Set(FREE).lower_bound(alloc_cursor_);
+  if (it == Set(FREE).end()) it = Set(FREE).begin();
+  int i = *it;
+  Set(FREE).erase(it);
+  Set(IN_USE).insert(i);
+  alloc_cursor_ = i + 1;
   pf.AddBufferOp();
   return At(i);
 }
 
 void VersionBuffer::FreeSlot(uint64_t mach_addr, State state, Profiler& pf) {
   int i = Index(mach_addr);
-  set<int>::iterator it = sets_[state].find(i);
-  assert(it != sets_[state].end());
-  sets_[state].erase(it);
-  sets_[FREE].insert(i);
+  set<int>::iterator it = Set(state).find(i);
+  assert(it != Set(state).end());
+  Set(state).erase(it);
+  Set(FREE).insert(i);
   pf.AddBufferOp();
 }
 
 void VersionBuffer::SlotBackup(uint64_t mach_addr, State state, Profiler& pf) {
   int i = Index(mach_addr);
-  assert(state == BACKUP0 || state == BACKUP1);
-  assert(sets_[state].count(i) == 0);
-  set<int>::iterator it = sets_[IN_USE].find(i);
-  assert(it != sets_[IN_USE].end());
-  sets_[IN_USE].erase(it);
-  sets_[state].insert(i);
+  assert(state >= BACKUP0 && state < depth_);
+  assert(Set(state).count(i) == 0);
+  set<int>::iterator it = Set(IN_USE).find(i);
+  assert(it != Set(IN_USE).end());
+  Set(IN_USE).erase(it);
+  Set(state).insert(i);
   pf.AddBufferOp();
 }
 
 void VersionBuffer::ClearBackup(Profiler& pf) {
-  for(set<int>::iterator it = sets_[BACKUP0].begin();
-      it != sets_[BACKUP0].end(); ++it) {
-    sets_[FREE].insert(*it);
+  for(set<int>::iterator it = Set(BACKUP0).begin();
+      it != Set(BACKUP0).end(); ++it) {
+    Set(FREE).insert(*it);
   }
-  sets_[BACKUP0].clear();
+  Set(BACKUP0).clear();
   pf.AddBufferOp(); // assumed in parallel
 
-  for(set<int>::iterator it = sets_[BACKUP1].begin();
-      it != sets_[BACKUP1].end(); ++it) {
-    sets_[BACKUP0].insert(*it);
+  for (int level = 1; level < depth_; ++level) {
+    Set(Backup(level - 1)).swap(Set(Backup(level)));
+    pf.AddBufferOp(); // assumed in parallel
   }
-  sets_[BACKUP1].clear();
-  pf.AddBufferOp(); // assumed in parallel
 
-  assert(sets_[IN_USE].size() + sets_[FREE].size() +
-      sets_[BACKUP0].size() == (unsigned int)length_);
+#ifndef NDEBUG
+  unsigned int num = Set(IN_USE).size() + Set(FREE).size();
+  for (int level = 0; level < depth_ - 1; ++level) {
+    num += Set(Backup(level)).size();
+  }
+  assert(Set(Backup(depth_ - 1)).empty() && num == (unsigned int)length_);
+#endif
 }
-
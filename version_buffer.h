@@ -16,13 +16,15 @@
 class VersionBuffer {
  public:
   enum State {
-    BACKUP0 = 0,
-    BACKUP1,
-    IN_USE,
-    FREE, // max queue index
+    IN_USE = -2,
+    FREE = -1,
+    BACKUP0 = 0, ///< Backups of the last committed epoch
+    BACKUP1, ///< Deeper levels, up to depth - 1, for epochs in checkpointing
   };
 
-  VersionBuffer(int length, int block_bits);
+  /// @depth Number of backup levels
+  VersionBuffer(int length, int block_bits, int depth = 2);
+  static State Backup(int level) { return State(BACKUP0 + level); }
 
   uint64_t SlotAlloc(Profiler& pf);
   void FreeSlot(uint64_t mach_addr, State state, Profiler& pf);
@@ -32,6 +34,7 @@ class VersionBuffer {
   uint64_t addr_base() const { return addr_base_; }
   void set_addr_base(uint64_t base) { addr_base_ = base; }
   int length() const { return length_; }
+  int depth() const { return depth_; }
   int block_size() const { return 1 << block_bits_; }
   /// The total address space size that this buffer area covers in bytes
   uint64_t Size() const;
@@ -39,23 +42,32 @@ class VersionBuffer {
  private:
   uint64_t At(int index);
   int Index(uint64_t mach_addr);
+  std::set<int>& Set(State state);
 
   uint64_t addr_base_;
   const int length_;
   const int block_bits_;
+  const int depth_;
   const uint64_t block_mask_;
   std::vector<std::set<int>> sets_;
+  int alloc_cursor_; ///< Allocation rotates over slots to spread wear
 };
 
-inline VersionBuffer::VersionBuffer(int length, int block_bits) :
-    length_(length), block_bits_(block_bits),
-    block_mask_(block_size() - 1), sets_(FREE + 1) {
+inline VersionBuffer::VersionBuffer(int length, int block_bits, int depth) :
+    length_(length), block_bits_(block_bits), depth_(depth),
+    block_mask_(block_size() - 1), sets_(depth - IN_USE), alloc_cursor_(0) {
+  assert(depth_ >= 2);
   for (int i = 0; i < length_; ++i) {
-    sets_[FREE].insert(i);
+    Set(FREE).insert(i);
   }
   addr_base_ = INVAL_ADDR;
 }
 
+inline std::set<int>& VersionBuffer::Set(State state) {
+  assert(state >= IN_USE && state < depth_);
+  return sets_[state - IN_USE];
+}
+
 inline uint64_t VersionBuffer::Size() const {
   return length_ << block_bits_;
 }
@@ -0,0 +1,70 @@
+// write_buffer.h
+// Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>
+
+#ifndef SEXAIN_WRITE_BUFFER_H_
+#define SEXAIN_WRITE_BUFFER_H_
+
+#include <cstdint>
+#include <cerrno>
+#include <cassert>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+/// Write-combining buffer of NVM blocks with LRU replacement.
+/// It keeps block addresses only; data stays in the memory store.
+class WriteBuffer {
+ public:
+  WriteBuffer(int capacity) : capacity_(capacity) { assert(capacity_ >= 0); }
+
+  bool Contains(uint64_t block_addr) const;
+  /// Returns true if the write is combined with a buffered one.
+  /// Otherwise buffers the block, and sets @victim to the evicted block
+  /// (or -EINVAL) when the buffer is full.
+  bool Write(uint64_t block_addr, uint64_t* victim);
+  /// Moves all buffered blocks to the list and returns their number
+  int Flush(std::vector<uint64_t>* list);
+
+  int capacity() const { return capacity_; }
+  int size() const { return blocks_.size(); }
+
+ private:
+  typedef std::list<uint64_t>::iterator LRUIterator;
+
+  const int capacity_;
+  std::list<uint64_t> lru_; ///< The most recently written at front
+  std::unordered_map<uint64_t, LRUIterator> blocks_;
+};
+
+inline bool WriteBuffer::Contains(uint64_t block_addr) const {
+  return blocks_.find(block_addr) != blocks_.end();
+}
+
+inline bool WriteBuffer::Write(uint64_t block_addr, uint64_t* victim) {
+  assert(capacity_ > 0);
+  *victim = -EINVAL;
+  std::unordered_map<uint64_t, LRUIterator>::iterator it =
+      blocks_.find(block_addr);
+  if (it != blocks_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return true;
+  }
+  if (size() == capacity_) {
+    *victim = lru_.back();
+    blocks_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(block_addr);
+  blocks_[block_addr] = lru_.begin();
+  return false;
+}
+
+inline int WriteBuffer::Flush(std::vector<uint64_t>* list) {
+  const int num = blocks_.size();
+  list->insert(list->end(), lru_.begin(), lru_.end());
+  lru_.clear();
+  blocks_.clear();
+  return num;
+}
+
+#endif // SEXAIN_WRITE_BUFFER_H_